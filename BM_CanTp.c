@@ -0,0 +1,181 @@
+/** ==================================================================================================================*\
+  @file BM_CanTp.c
+
+  @brief Benchmarki wydajnościowe do CanTp.c
+
+  Build: gcc -O2 BM_CanTp.c -o BM_CanTp
+         gcc -O2 -DCONFIG_CANTP_SOA_LAYOUT BM_CanTp.c -o BM_CanTp_SoA
+\*====================================================================================================================*/
+
+/*====================================================================================================================*\
+    Includes
+\*====================================================================================================================*/
+// Room for 512 NSdus in each direction
+#define CONFIG_CAN_TP_MAX_CHANNELS_COUNT (uint32)8
+#define CONFIG_CANTP_MAX_RX_NSDU_PER_CHANNEL (uint32)64
+#define CONFIG_CANTP_MAX_TX_NSDU_PER_CHANNEL (uint32)64
+// Every NSdu can be bound at once, so a MainFunction pass visits all of them
+#define CONFIG_CANTP_RX_CONNECTIONS_COUNT (uint32)512
+#define CONFIG_CANTP_TX_CONNECTIONS_COUNT (uint32)512
+
+#include <stdio.h>
+#include <time.h>
+
+#include "CanTp.c"
+
+/*====================================================================================================================*\
+    Stubs
+\*====================================================================================================================*/
+Std_ReturnType Det_ReportRuntimeError(uint16 moduleId, uint8 instanceId, uint8 apiId, uint8 errorId){
+    return E_OK;
+}
+Std_ReturnType CanIf_Transmit(PduIdType txPduId, const PduInfoType *pPduInfo){
+    return E_OK;
+}
+BufReq_ReturnType PduR_CanTpCopyRxData(PduIdType rxPduId, const PduInfoType *pPduInfo, PduLengthType *pBuffer){
+    return BUFREQ_OK;
+}
+BufReq_ReturnType PduR_CanTpCopyTxData(PduIdType txPduId, const PduInfoType *pPduInfo, const RetryInfoType *pRetryInfo, PduLengthType *pAvailableData){
+    return BUFREQ_OK;
+}
+void PduR_CanTpRxIndication(PduIdType rxPduId, Std_ReturnType result){
+}
+BufReq_ReturnType PduR_CanTpStartOfReception(PduIdType pduId, const PduInfoType *pPduInfo, PduLengthType tpSduLength, PduLengthType *pBufferSize){
+    *pBufferSize = tpSduLength;
+    return BUFREQ_OK;
+}
+void PduR_CanTpTxConfirmation(PduIdType txPduId, Std_ReturnType result){
+}
+
+/*====================================================================================================================*\
+    Helpers
+\*====================================================================================================================*/
+#define BM_LOOKUPS 4000000U
+#define BM_MAIN_FUNCTION_CALLS 200000U
+
+static PduIdType bmIds[CANTP_RX_NSDU_COUNT];
+static CanTp_ConfigType bmConfig;
+static volatile uintptr_t bmSink;
+
+static uint64 nowNs(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64)ts.tv_sec * 1000000000ULL) + (uint64)ts.tv_nsec;
+}
+
+// Reference implementation: the linear scan used before the index was introduced
+static CanTp_RxNSduSlot *linearRxLookup(PduIdType PduId){
+    CanTp_RxNSduSlot *rxConnection = NULL;
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxNSdus) && !rxConnection; connItr++){
+        if (CanTp_State.rxNSdus[connItr].nsdu != NULL){
+            if (CanTp_State.rxNSdus[connItr].nsdu->id == PduId){
+                rxConnection = &CanTp_State.rxNSdus[connItr];
+            }
+        }
+    }
+    return rxConnection;
+}
+
+static void configureTxNSdus(uint32 count){
+    for (uint32 chItr = 0; chItr < CONFIG_CAN_TP_MAX_CHANNELS_COUNT; chItr++){
+        bmConfig.channels[chItr].txNSduCount = 0;
+    }
+
+    for (uint32 nsduItr = 0; nsduItr < count; nsduItr++){
+        CanTp_ChannelType *channel = &bmConfig.channels[nsduItr / CONFIG_CANTP_MAX_TX_NSDU_PER_CHANNEL];
+        CanTp_TxNSduType *nsdu = &channel->txNSdu[channel->txNSduCount++];
+
+        nsdu->id = (PduIdType)(0x8000U + nsduItr);
+    }
+}
+
+static void configureRxNSdus(uint32 count, uint32 idStride){
+    for (uint32 chItr = 0; chItr < CONFIG_CAN_TP_MAX_CHANNELS_COUNT; chItr++){
+        bmConfig.channels[chItr].rxNSduCount = 0;
+    }
+
+    for (uint32 nsduItr = 0; nsduItr < count; nsduItr++){
+        CanTp_ChannelType *channel = &bmConfig.channels[nsduItr / CONFIG_CANTP_MAX_RX_NSDU_PER_CHANNEL];
+        CanTp_RxNSduType *nsdu = &channel->rxNSdu[channel->rxNSduCount++];
+
+        nsdu->id = (PduIdType)(0x100U + (nsduItr * idStride));
+        bmIds[nsduItr] = nsdu->id;
+    }
+    CanTp_Init(&bmConfig);
+}
+
+static double measure(CanTp_RxNSduSlot *(*lookup)(PduIdType), uint32 count){
+    uint32 idx = 0;
+    uint64 start = nowNs();
+
+    for (uint32 itr = 0; itr < BM_LOOKUPS; itr++){
+        // Stride through the ids so consecutive lookups hit different connections
+        idx = (idx + 7U) % count;
+        bmSink += (uintptr_t)lookup(bmIds[idx]);
+    }
+    return (double)(nowNs() - start) / BM_LOOKUPS;
+}
+
+// Binds every NSdu to a connection waiting for the peer (CF on rx, FC on tx), the common state of a busy gateway
+static void bindAllConnections(uint32 count){
+    configureTxNSdus(count);
+    configureRxNSdus(count, 1);
+
+    for (uint32 nsduItr = 0; nsduItr < count; nsduItr++){
+        CanTp_RxConnection *rxConn = CanTp_RxBind(&CanTp_State.rxNSdus[nsduItr]);
+        CanTp_TxConnection *txConn = CanTp_TxBind(&CanTp_State.txNSdus[nsduItr]);
+
+        CANTP_RX_ACTIVATION(rxConn) = CANTP_RX_PROCESSING;
+        CanTp_RxSetState(rxConn, CANTP_RX_STATE_WAIT_CF);
+        CANTP_TX_ACTIVATION(txConn) = CANTP_TX_PROCESSING;
+        CanTp_TxSetState(txConn, CANTP_TX_STATE_WAIT_FC);
+    }
+}
+
+static double measureMainFunction(uint32 count){
+    uint64 start;
+
+    bindAllConnections(count);
+    start = nowNs();
+    for (uint32 itr = 0; itr < BM_MAIN_FUNCTION_CALLS; itr++){
+        CanTp_MainFunction();
+    }
+    // Both directions are visited on each call
+    return (double)(nowNs() - start) / ((double)BM_MAIN_FUNCTION_CALLS * 2U * count);
+}
+
+/*====================================================================================================================*\
+    Benchmarks
+\*====================================================================================================================*/
+int main(void){
+    const uint32 counts[] = {8, 64, 512};
+    const struct{
+        const char *name;
+        uint32 stride;
+    } layouts[] = {{"dense", 1}, {"sparse", 97}, {"pow2", 64}};
+
+    // Buffers and frame layouts live in the pooled connections, an NSdu only costs its slot
+    printf("CanTp_State %u bytes: NSdu slot rx %u / tx %u, connection rx %u / tx %u, frame buffer pool %u\n\n",
+           (unsigned)sizeof(CanTp_State), (unsigned)sizeof(CanTp_RxNSduSlot), (unsigned)sizeof(CanTp_TxNSduSlot),
+           (unsigned)sizeof(CanTp_RxConnection), (unsigned)sizeof(CanTp_TxConnection), (unsigned)sizeof(CanTp_State.frameBufferPool));
+    printf("%-8s %-8s %-8s %14s %14s\n", "NSdus", "ids", "index", "linear ns/op", "index ns/op");
+    for (uint32 layoutItr = 0; layoutItr < ARR_SIZE(layouts); layoutItr++){
+        for (uint32 countItr = 0; countItr < ARR_SIZE(counts); countItr++){
+            configureRxNSdus(counts[countItr], layouts[layoutItr].stride);
+            printf("%-8u %-8s %-8s %14.2f %14.2f\n", (unsigned)counts[countItr], layouts[layoutItr].name,
+                   CanTp_State.rxIndex.direct ? "direct" : "hashed",
+                   measure(linearRxLookup, counts[countItr]), measure(CanTp_RxNSduLookup, counts[countItr]));
+        }
+    }
+
+#if defined(CONFIG_CANTP_SOA_LAYOUT)
+    const char *layout = "SoA";
+#else
+    const char *layout = "AoS";
+#endif
+    printf("\n%-8s %-8s %22s\n", "NSdus", "layout", "MainFunction ns/conn");
+    for (uint32 countItr = 0; countItr < ARR_SIZE(counts); countItr++){
+        printf("%-8u %-8s %22.3f\n", (unsigned)counts[countItr], layout, measureMainFunction(counts[countItr]));
+    }
+    return 0;
+}
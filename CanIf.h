@@ -9,4 +9,10 @@
 
 Std_ReturnType CanIf_Transmit(PduIdType txPduId, const PduInfoType *pPduInfo);
 
+/**
+ * @brief Requests transmission of a frame made of pHeader followed by pPayload.
+ * Both buffers are only read during the call.
+ */
+Std_ReturnType CanIf_TransmitGather(PduIdType txPduId, const PduInfoType *pHeader, const PduInfoType *pPayload);
+
 #endif
\ No newline at end of file
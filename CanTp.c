@@ -32,6 +32,46 @@
 #define CANTP_SF_PCI_SIZE 0x01
 #define CANTP_FF_PCI_SIZE 0x02
 #define CANTP_CF_PCI_SIZE 0x01
+// Escape sequences: SF_DL in a separate byte (CAN_DL > 8), 32 bit FF_DL (FF_DL > 4095)
+#define CANTP_SF_ESC_PCI_SIZE 0x02
+#define CANTP_FF_ESC_PCI_SIZE 0x06
+#define CANTP_FF_DL_12BIT_MAX (PduLengthType)0x0FFFU
+
+#define CANTP_RX_NSDU_COUNT (CONFIG_CAN_TP_MAX_CHANNELS_COUNT * CONFIG_CANTP_MAX_RX_NSDU_PER_CHANNEL)
+#define CANTP_TX_NSDU_COUNT (CONFIG_CAN_TP_MAX_CHANNELS_COUNT * CONFIG_CANTP_MAX_TX_NSDU_PER_CHANNEL)
+#define CANTP_RX_CONNECTIONS_COUNT CONFIG_CANTP_RX_CONNECTIONS_COUNT
+#define CANTP_TX_CONNECTIONS_COUNT CONFIG_CANTP_TX_CONNECTIONS_COUNT
+
+// Index tables are kept at most half full, so hashed lookups terminate after a few probes
+#define CANTP_RX_PDU_INDEX_SIZE (2U * CANTP_RX_NSDU_COUNT)
+#define CANTP_TX_PDU_INDEX_SIZE (2U * CANTP_TX_NSDU_COUNT)
+#define CANTP_PDU_INDEX_INVALID (uint16)0xFFFFU
+// CAN_ID_32 meta data, least significant byte first
+#define CANTP_CAN_ID_32_LEN 4U
+// 29 bit identifiers of normal fixed and mixed 29 bit addressing: priority 6, PF, N_TA, N_SA (ISO 15765-2)
+#define CANTP_FIXED_CAN_ID_PRIORITY 0x18000000UL
+#define CANTP_PF_NORMALFIXED_PHYSICAL 0xDAU
+#define CANTP_PF_NORMALFIXED_FUNCTIONAL 0xDBU
+#define CANTP_PF_MIXED29_PHYSICAL 0xCEU
+#define CANTP_PF_MIXED29_FUNCTIONAL 0xCDU
+
+// Fields read on every CanTp_MainFunction pass, kept in parallel arrays of CanTp_State with CONFIG_CANTP_SOA_LAYOUT
+// The _AT variants take the pool index and let the CanTp_MainFunction pass skip idle connections without loading them
+#if defined(CONFIG_CANTP_SOA_LAYOUT)
+#define CANTP_RX_STATE_AT(connIdx) (CanTp_State.rxState[(connIdx)])
+#define CANTP_TX_STATE_AT(connIdx) (CanTp_State.txState[(connIdx)])
+#define CANTP_RX_STATE(conn) (CanTp_State.rxState[(conn) - CanTp_State.rxConnections])
+#define CANTP_RX_ACTIVATION(conn) (CanTp_State.rxActivation[(conn) - CanTp_State.rxConnections])
+#define CANTP_TX_STATE(conn) (CanTp_State.txState[(conn) - CanTp_State.txConnections])
+#define CANTP_TX_ACTIVATION(conn) (CanTp_State.txActivation[(conn) - CanTp_State.txConnections])
+#else
+#define CANTP_RX_STATE_AT(connIdx) (CanTp_State.rxConnections[(connIdx)].state)
+#define CANTP_TX_STATE_AT(connIdx) (CanTp_State.txConnections[(connIdx)].state)
+#define CANTP_RX_STATE(conn) ((conn)->state)
+#define CANTP_RX_ACTIVATION(conn) ((conn)->activation)
+#define CANTP_TX_STATE(conn) ((conn)->state)
+#define CANTP_TX_ACTIVATION(conn) ((conn)->activation)
+#endif
 
 /*====================================================================================================================*\
     Typy lokalne
@@ -76,6 +116,8 @@ typedef enum{
     CANTP_RX_STATE_FREE,
     CANTP_RX_STATE_WAIT_CF,
     CANTP_RX_STATE_FC_TX_REQ,
+    // FC.WAIT sent, PduR is asked for buffer again when N_Br elapses
+    CANTP_RX_STATE_WAIT_BUFFER,
     CANTP_RX_STATE_PROCESSED,
     CANTP_RX_STATE_ABORT,
     CANTP_RX_STATE_INVALID
@@ -85,55 +127,261 @@ typedef enum{
 typedef struct{
     uint8 payloadOffset;
     uint8 payloadLength;
-#if defined(CONFIG_CAN_2_0_OR_CAN_FD)
-    uint8 data[CAN_2_0_MAX_LEN];
-#elif defined(CONFIG_CAN_FD_ONLY)
-    uint8 data[CAN_FD_MAX_LEN];
-#endif
+    // Slice of CanTp_State.frameBufferPool
+    uint8 *data;
 } CanTp_ConnectionBuffer;
 
+/**
+ * Tx data fetched from PduR ahead of the CFs. Bytes [offset, offset + count) are not sent yet.
+ */
+typedef struct{
+    uint8 *data;
+    uint16 size;
+    uint16 offset;
+    uint16 count;
+} CanTp_TxStaging;
+
+/**
+ * CF payloads received since the last PduR_CanTpCopyRxData.
+ */
+typedef struct{
+    uint8 *data;
+    uint16 size;
+    uint16 count;
+} CanTp_RxReassembly;
+
+/**
+ * Frame sizes of an NSdu, derived from its configuration when a connection is bound so the frame paths do not
+ * recompute them.
+ */
+typedef struct{
+    // CAN frame length, CanTp_FrameLen of maxFrameLen
+    uint8 frameLen;
+    // Length of the N_AE / N_TA byte in front of the N_PCI
+    uint8 nAe;
+    // Largest SF payload, longer messages are segmented
+    uint8 sfPayload;
+    uint8 cfPayload;
+    // Minimum length of received frames, 0 without padding
+    uint8 padLen;
+    uint8 fcLen;
+    // N_TA (extended) or N_AE (mixed) byte put in front of sent frames and expected in received ones
+    uint8 txAddr;
+    uint8 rxAddr;
+    // The NSdu configures its address, received frames with another one are not for it
+    boolean checkAddr;
+    // N_SA and N_TA are carried by the 29 bit CAN ID in CAN_ID_32 meta data
+    boolean canIdAddr;
+} CanTp_FrameLayout;
+
+/**
+ * Configured NSdu. Holds what outlives a transfer, the runtime state, the frame layout and the buffers live in
+ * a connection bound to the NSdu from the SF/FF until the reception is finished.
+ */
+typedef struct{
+    // Points to nsdu in CanTp_State.config
+    const CanTp_RxNSduType *nsdu;
+    const CanTp_ChannelType *channel;
+    // BS and STmin sent in FC, loaded from nsdu in CanTp_Init and changed by CanTp_ChangeParameter
+    uint8 bs;
+    uint16 stMin;
+    // Index of the bound connection in CanTp_State.rxConnections, CANTP_PDU_INDEX_INVALID when idle
+    uint16 connIdx;
+} CanTp_RxNSduSlot;
+
+typedef struct{
+    const CanTp_TxNSduType *nsdu;
+    const CanTp_ChannelType *channel;
+    uint16 connIdx;
+} CanTp_TxNSduSlot;
+
 typedef struct{
+#if !defined(CONFIG_CANTP_SOA_LAYOUT)
+    // Accessed through CANTP_RX_ACTIVATION and CANTP_RX_STATE
     CanTp_RxNSduState activation;
-    // Points to nsdu in CanTp_Config.channels
-    CanTp_RxNSduType *nsdu;
     CanTp_RxConnectionState state;
-    struct{
-        uint32 ar;
-        uint32 br;
-        uint32 cr;
-    } timer;
+#endif
+    // NSdu the connection is bound to, copied from CanTp_State.rxNSdus[nsduIdx]
+    const CanTp_RxNSduType *nsdu;
+    const CanTp_ChannelType *channel;
+    // Layout of the NSdu, set on binding and read on every frame
+    CanTp_FrameLayout layout;
+    uint16 nsduIdx;
+    // Position in CanTp_State.rxActive, below rxActiveCount while the connection is bound
+    uint16 activeSlot;
+    // CanTp_State.currentTime of binding, the oldest reception is evicted first
+    uint32 bindTime;
     PduInfoType pduInfo;
     PduLengthType buffSize;
     PduLengthType aquiredBuffSize;
     uint8 sn;
+    // BS sent in the last FC and the CFs left in the current block
+    uint8 blockSize;
     uint8 bs;
     CanTp_FsType fs;
+    // FC.WAIT sent in a row, limited by wftMax
+    uint16 wftCount;
+    // FF payload in ffBuf waits for PduR_CanTpStartOfReception to accept it
+    boolean startPending;
+    // FC handed to CanIf and not confirmed yet, supervised by N_Ar
+    boolean fcPending;
+    // CanTp_State.frameSeq of the pending FC
+    uint32 fcSeq;
+    // Copy of an FF payload kept while PduR_CanTpStartOfReception is busy, NULL without an NSdu setting wftMax
+    uint8 *ffBuf;
+    // N_SA of the tester, the reception is found by it in CanTp_State.rxPeerIndex
+    uint8 peerAddr;
+    boolean peerBound;
+    // CAN ID of the SF/FF passed to PduR and the CAN ID the FC is sent with
+    uint8 metaData[CANTP_CAN_ID_32_LEN];
+    uint8 fcMetaData[CANTP_CAN_ID_32_LEN];
+    // Slices of CanTp_State.frameBufferPool carved in CanTp_Init, sized for the largest NSdu
     CanTp_ConnectionBuffer fcBuf;
+    CanTp_RxReassembly reassembly;
 } CanTp_RxConnection;
 
 typedef struct{
+#if !defined(CONFIG_CANTP_SOA_LAYOUT)
+    // Accessed through CANTP_TX_ACTIVATION and CANTP_TX_STATE
     CanTp_TxNSduState activation;
-    // Points to nsdu in CanTp_Config.channels
-    CanTp_TxNSduType *nsdu;
     CanTp_TxConnectionState state;
+#endif
+    // NSdu the connection is bound to, copied from CanTp_State.txNSdus[nsduIdx]
+    const CanTp_TxNSduType *nsdu;
+    const CanTp_ChannelType *channel;
+    CanTp_FrameLayout layout;
+    uint16 nsduIdx;
+    // Position in CanTp_State.txActive, below txActiveCount while the connection is bound
+    uint16 activeSlot;
     PduInfoType pduInfo;
+    // Slice of CanTp_State.frameBufferPool carved in CanTp_Init, holds a frame of the NSdu with the longest frames
     CanTp_ConnectionBuffer buf;
-    struct{
-        uint32 as;
-        uint32 bs;
-        uint32 cs;
-    } timer;
-
     uint8 sequenceNumber;
+    // Type of the N-PDU waiting for CanTp_TxConfirmation
+    CanTp_PciType lastFrameType;
+    // BS and STmin received in the last FC
+    uint8 bs;
+    uint8 stMin;
+    // CFs left until the receiver sends the next FC, only counted when bs is not 0
+    uint8 blockRemaining;
+    CanTp_TxStaging staging;
+    // Earliest CanTp_State.currentTime at which the next CF respects STmin
+    uint32 nextCfTime;
+    // Passed to PduR_CanTpCopyTxData: TP_CONFPENDING keeps the data of the current block in PduR, TP_DATA_CONF
+    // releases it once the receiver asked for the next block, TP_DATARETRY rewinds to a lost frame
+    RetryInfoType retry;
+    // Data PduR reported as available by the last PduR_CanTpCopyTxData, less than the rest of a streamed SDU
+    PduLengthType availableData;
+    // Retransmissions of the N-PDU waiting for CanTp_TxConfirmation
+    uint8 retryCount;
+    // CFs are sent by a loop up the stack, a confirmation from within CanIf_Transmit only updates the state
+    boolean dispatching;
+    // CanTp_State.frameSeq of the N-PDU waiting for CanTp_TxConfirmation
+    uint32 confirmSeq;
+    // CAN ID of the sent N-PDUs for canIdAddr, the FC is expected with N_SA and N_TA swapped
+    uint8 metaData[CANTP_CAN_ID_32_LEN];
+    uint8 peerAddr;
+    uint8 localAddr;
+#if defined(CONFIG_CANTP_ZERO_COPY_TX)
+    // SDU retained by CanTp_Transmit for zero-copy NSdus, NULL when the data is copied from PduR
+    uint8 *sduData;
+    PduLengthType sduLength;
+    // Offset in sduData of the first byte not yet assigned to an N-PDU
+    PduLengthType sduOffset;
+    // Payload of the N-PDU being sent, points into sduData
+    uint8 *payloadData;
+#endif
 } CanTp_TxConnection;
 
+typedef enum{
+    CANTP_TIMER_NONE = 0,
+    CANTP_TIMER_N_AS,
+    CANTP_TIMER_N_BS,
+    CANTP_TIMER_N_CS,
+    CANTP_TIMER_N_AR,
+    CANTP_TIMER_N_BR,
+    CANTP_TIMER_N_CR
+} CanTp_TimerType;
+
+/**
+ * Absolute deadline of the single timeout supervising a connection.
+ * Timers of rx connection i use slot i, timers of tx connection j use slot CANTP_RX_CONNECTIONS_COUNT + j.
+ * Links hold slot + 1, so 0 terminates a wheel bucket and a zero-initialized wheel is empty.
+ */
+typedef struct{
+    uint32 deadline;
+    uint16 next;
+    uint16 prev;
+    CanTp_TimerType type;
+} CanTp_Timer;
+
+typedef struct{
+    uint32 id;
+    // Index of the NSdu slot in CanTp_State, CANTP_PDU_INDEX_INVALID for an empty entry
+    uint16 connIdx;
+} CanTp_PduIndexEntry;
+
+/**
+ * PduId to NSdu slot lookup table built in CanTp_Init.
+ * If the configured ids fit into the table they are addressed directly (entries[id - baseId]),
+ * otherwise the table is used as an open addressing hash (Fibonacci hashing) with linear probing.
+ * Keys are PduIds, or CANTP_ADDR_KEY of an N-PDU id and an address byte.
+ */
+typedef struct{
+    CanTp_PduIndexEntry *entries;
+    uint32 size;
+    uint32 baseId;
+    boolean direct;
+} CanTp_PduIndex;
+
+// Key of an NSdu sharing its N-PDU with others, told apart by the N_TA / N_AE byte
+#define CANTP_ADDR_KEY(nPduId, addr) ((((uint32)(nPduId)) << 8) | (uint32)(addr))
+
+
 typedef struct{
     CanTp_PaddingActivationType activation;
     uint32 currentTime;
-    CanTp_RxConnection
-        rxConnections[CONFIG_CAN_TP_MAX_CHANNELS_COUNT * CONFIG_CANTP_MAX_RX_NSDU_PER_CHANNEL];
-    CanTp_TxConnection
-        txConnections[CONFIG_CAN_TP_MAX_CHANNELS_COUNT * CONFIG_CANTP_MAX_TX_NSDU_PER_CHANNEL];
+    // Counts the N-PDUs handed to CanIf, orders the confirmations of an N-PDU shared by a transmission and receptions
+    uint32 frameSeq;
+    // Receptions with fcPending set, CanTp_TxConfirmation only looks for an FC while there is one
+    uint16 rxFcPendingCount;
+    // Configuration given to CanTp_Init, never written
+    const CanTp_ConfigType *config;
+    CanTp_RxNSduSlot rxNSdus[CANTP_RX_NSDU_COUNT];
+    CanTp_TxNSduSlot txNSdus[CANTP_TX_NSDU_COUNT];
+    // Pools of runtime connections shared by all NSdus
+    CanTp_RxConnection rxConnections[CANTP_RX_CONNECTIONS_COUNT];
+    CanTp_TxConnection txConnections[CANTP_TX_CONNECTIONS_COUNT];
+#if defined(CONFIG_CANTP_SOA_LAYOUT)
+    // Indexed like rxConnections/txConnections, a pass over idle connections does not load the structs
+    CanTp_RxConnectionState rxState[CANTP_RX_CONNECTIONS_COUNT];
+    CanTp_RxNSduState rxActivation[CANTP_RX_CONNECTIONS_COUNT];
+    CanTp_TxConnectionState txState[CANTP_TX_CONNECTIONS_COUNT];
+    CanTp_TxNSduState txActivation[CANTP_TX_CONNECTIONS_COUNT];
+#endif
+    CanTp_PduIndexEntry rxIndexEntries[CANTP_RX_PDU_INDEX_SIZE];
+    CanTp_PduIndexEntry txIndexEntries[CANTP_TX_PDU_INDEX_SIZE];
+    CanTp_PduIndex rxIndex;
+    CanTp_PduIndex txIndex;
+    // Rx NSdus with extended or mixed addressing by CANTP_ADDR_KEY of their rxNPdu id and address
+    CanTp_PduIndexEntry rxAddrIndexEntries[CANTP_RX_PDU_INDEX_SIZE];
+    CanTp_PduIndex rxAddrIndex;
+    // Receptions addressed by CAN ID by CANTP_ADDR_KEY of their NSdu slot and tester N_SA
+    CanTp_PduIndexEntry rxPeerIndexEntries[2U * CANTP_RX_CONNECTIONS_COUNT];
+    CanTp_PduIndex rxPeerIndex;
+    // Permutations of the pool indexes: the first rx/txActiveCount entries are the bound connections
+    // visited by CanTp_MainFunction, the rest are free
+    uint16 rxActive[CANTP_RX_CONNECTIONS_COUNT];
+    uint16 txActive[CANTP_TX_CONNECTIONS_COUNT];
+    uint32 rxActiveCount;
+    uint32 txActiveCount;
+    CanTp_PoolStatsType rxPoolStats;
+    CanTp_PoolStatsType txPoolStats;
+    // Hashed timer wheel, one bucket per MainFunction period
+    CanTp_Timer timers[CANTP_RX_CONNECTIONS_COUNT + CANTP_TX_CONNECTIONS_COUNT];
+    uint16 timerWheel[CONFIG_CANTP_TIMER_WHEEL_SIZE];
+    // Backing storage of the connection buffers
+    uint8 frameBufferPool[CONFIG_CANTP_FRAME_BUFFER_POOL_SIZE];
 } CanTp_State_t;
 
 typedef enum{
@@ -146,7 +394,8 @@ typedef enum{
 \*====================================================================================================================*/
 static CanTp_State_t CanTp_State;
 
-static CanTp_ConfigType config = {
+// Used when CanTp_Init is called without a configuration
+static const CanTp_ConfigType CanTp_DefaultConfig = {
     .channels = {
         {// Channel 0
          .rxNSdu = {{.id = 101}, {.id = 102}, {.id = 103}, {.id = 104}, {.id = 105}},
@@ -172,29 +421,6 @@ static CanTp_ConfigType config = {
 static CanTp_State_t CanTp_State = {
     .activation = CANTP_OFF,
     .currentTime = 0,
-    .rxConnections = {
-        {.nsdu = &config.channels[0].rxNSdu[0], .activation = CANTP_RX_WAIT},
-        {.nsdu = &config.channels[0].rxNSdu[1], .activation = CANTP_RX_WAIT},
-        {.nsdu = &config.channels[0].rxNSdu[2], .activation = CANTP_RX_WAIT},
-        {.nsdu = &config.channels[0].rxNSdu[3], .activation = CANTP_RX_WAIT},
-        {.nsdu = &config.channels[0].rxNSdu[4], .activation = CANTP_RX_WAIT},
-        {.nsdu = &config.channels[1].rxNSdu[0], .activation = CANTP_RX_WAIT},
-        {.nsdu = &config.channels[1].rxNSdu[1], .activation = CANTP_RX_WAIT},
-        {.nsdu = &config.channels[1].rxNSdu[2], .activation = CANTP_RX_WAIT},
-        {.nsdu = &config.channels[3].rxNSdu[0], .activation = CANTP_RX_WAIT},
-        {.nsdu = &config.channels[3].rxNSdu[1], .activation = CANTP_RX_WAIT},
-        {.nsdu = &config.channels[3].rxNSdu[2], .activation = CANTP_RX_WAIT},
-    },
-    .txConnections = {
-        {.nsdu = &config.channels[0].txNSdu[0], .activation = CANTP_TX_WAIT},
-        {.nsdu = &config.channels[1].txNSdu[0], .activation = CANTP_TX_WAIT},
-        {.nsdu = &config.channels[1].txNSdu[1], .activation = CANTP_TX_WAIT},
-        {.nsdu = &config.channels[1].txNSdu[2], .activation = CANTP_TX_WAIT},
-        {.nsdu = &config.channels[1].txNSdu[3], .activation = CANTP_TX_WAIT},
-        {.nsdu = &config.channels[1].txNSdu[4], .activation = CANTP_TX_WAIT},
-        {.nsdu = &config.channels[2].txNSdu[0], .activation = CANTP_TX_WAIT},
-        {.nsdu = &config.channels[2].txNSdu[1], .activation = CANTP_TX_WAIT},
-    },
 };
 
 /*====================================================================================================================*\
@@ -206,35 +432,196 @@ static inline void memzero(uint8_t *ptr, uint32_t size){
     }
 }
 
-static CanTp_TxConnection *getTxConnection(PduIdType PduId){
-    CanTp_TxConnection *txConnection = NULL;
-    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.txConnections) && !txConnection;
-         connItr++) {
-        if (CanTp_State.txConnections[connItr].nsdu != NULL) {
-            if (CanTp_State.txConnections[connItr].nsdu->id == PduId) {
-                txConnection = &CanTp_State.txConnections[connItr];
-            }
+static void CanTp_PduIndexReset(CanTp_PduIndex *index, CanTp_PduIndexEntry *entries, uint32 size, uint32 minId, uint32 maxId){
+    index->entries = entries;
+    index->size = size;
+    index->baseId = minId;
+    index->direct = ((uint32)(maxId - minId) < size);
+
+    for (uint32 entryItr = 0; entryItr < size; entryItr++){
+        entries[entryItr].id = 0;
+        entries[entryItr].connIdx = CANTP_PDU_INDEX_INVALID;
+    }
+}
+
+// First probe of an id. The multiplication spreads ids assigned with a power-of-two stride, which a plain
+// id % size would pile up in a few clusters.
+static inline uint32 CanTp_PduIndexHome(const CanTp_PduIndex *index, uint32 id){
+    return (uint32)(((uint64)(uint32)(id * 0x9E3779B9U) * index->size) >> 32);
+}
+
+static void CanTp_PduIndexInsert(CanTp_PduIndex *index, uint32 id, uint16 connIdx){
+    uint32 home = CanTp_PduIndexHome(index, id);
+    CanTp_PduIndexEntry *entry;
+
+    if (index->direct){
+        entry = &index->entries[id - index->baseId];
+        // First configured connection wins, same as the order of configuration
+        if (entry->connIdx == CANTP_PDU_INDEX_INVALID){
+            entry->id = id;
+            entry->connIdx = connIdx;
+        }
+        return;
+    }
+
+    for (uint32 probe = 0; probe < index->size; probe++){
+        entry = &index->entries[(home + probe) % index->size];
+        if (entry->connIdx == CANTP_PDU_INDEX_INVALID){
+            entry->id = id;
+            entry->connIdx = connIdx;
+            return;
+        }
+        if (entry->id == id){
+            return;
         }
     }
-    return txConnection;
 }
 
-static CanTp_RxConnection *getRxConnection(PduIdType PduId){
-    CanTp_RxConnection *rxConnection = NULL;
-    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxConnections) && !rxConnection; connItr++){
-        if (CanTp_State.rxConnections[connItr].nsdu != NULL){
-            if (CanTp_State.rxConnections[connItr].nsdu->id == PduId){
-                rxConnection = &CanTp_State.rxConnections[connItr];
-            }
+/**
+  @brief Removes an entry of a hashed index
+
+  The entries after it in the probe sequence are shifted back, so lookups do not stop at the hole.
+*/
+static void CanTp_PduIndexRemove(CanTp_PduIndex *index, uint32 id){
+    uint32 hole = index->size;
+    uint32 next;
+    uint32 home = CanTp_PduIndexHome(index, id);
+
+    for (uint32 probe = 0; probe < index->size; probe++){
+        next = (home + probe) % index->size;
+        if (index->entries[next].connIdx == CANTP_PDU_INDEX_INVALID){
+            return;
+        }
+        if (index->entries[next].id == id){
+            hole = next;
+            break;
+        }
+    }
+    if (hole == index->size){
+        return;
+    }
+
+    next = hole;
+    for (uint32 probe = 1; probe < index->size; probe++){
+        next = (next + 1U) % index->size;
+        if (index->entries[next].connIdx == CANTP_PDU_INDEX_INVALID){
+            break;
+        }
+        // An entry may fill the hole unless its home position lies cyclically in (hole, next]
+        home = CanTp_PduIndexHome(index, index->entries[next].id);
+        if (((next > hole) && ((home <= hole) || (home > next))) || ((next < hole) && (home <= hole) && (home > next))){
+            index->entries[hole] = index->entries[next];
+            hole = next;
         }
     }
-    return rxConnection;
+    index->entries[hole].id = 0;
+    index->entries[hole].connIdx = CANTP_PDU_INDEX_INVALID;
 }
 
-static inline CanTp_PciType CanTp_DecodeFrameType(const uint8 *sdu){
-    return (((sdu[0]) >> 4) & 0xF);
+static uint16 CanTp_PduIndexLookup(const CanTp_PduIndex *index, uint32 id){
+    const CanTp_PduIndexEntry *entry;
+    uint32 home;
+
+    if (index->size == 0){
+        return CANTP_PDU_INDEX_INVALID;
+    }
+
+    if (index->direct){
+        if ((id < index->baseId) || ((uint32)(id - index->baseId) >= index->size)){
+            return CANTP_PDU_INDEX_INVALID;
+        }
+        return index->entries[id - index->baseId].connIdx;
+    }
+
+    home = CanTp_PduIndexHome(index, id);
+    for (uint32 probe = 0; probe < index->size; probe++){
+        entry = &index->entries[(home + probe) % index->size];
+        if ((entry->connIdx == CANTP_PDU_INDEX_INVALID) || (entry->id == id)){
+            return entry->connIdx;
+        }
+    }
+    return CANTP_PDU_INDEX_INVALID;
+}
+
+/**
+  @brief Assigns the NSdus of the configuration to slots, channel by channel
+
+  Only pointers into the configuration are kept, so it can be placed in ROM.
+*/
+static void CanTp_LoadConfig(const CanTp_ConfigType *cfg){
+    uint32 rxCount = 0;
+    uint32 txCount = 0;
+
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxNSdus); connItr++){
+        CanTp_State.rxNSdus[connItr] = (CanTp_RxNSduSlot){.nsdu = NULL};
+    }
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.txNSdus); connItr++){
+        CanTp_State.txNSdus[connItr] = (CanTp_TxNSduSlot){.nsdu = NULL};
+    }
+    for (uint32 chItr = 0; chItr < ARR_SIZE(cfg->channels); chItr++){
+        const CanTp_ChannelType *channel = &cfg->channels[chItr];
+
+        for (uint32 nsduItr = 0; (nsduItr < channel->rxNSduCount) && (nsduItr < ARR_SIZE(channel->rxNSdu)); nsduItr++){
+            CanTp_RxNSduSlot *slot = &CanTp_State.rxNSdus[rxCount++];
+            slot->nsdu = &channel->rxNSdu[nsduItr];
+            slot->channel = channel;
+            slot->bs = slot->nsdu->bs;
+            slot->stMin = (uint16)slot->nsdu->STmin;
+        }
+        for (uint32 nsduItr = 0; (nsduItr < channel->txNSduCount) && (nsduItr < ARR_SIZE(channel->txNSdu)); nsduItr++){
+            CanTp_TxNSduSlot *slot = &CanTp_State.txNSdus[txCount++];
+            slot->nsdu = &channel->txNSdu[nsduItr];
+            slot->channel = channel;
+        }
+    }
+}
+
+// Length of the CAN frame carrying the given number of bytes, CAN FD frames above 8 bytes take the next DLC
+static const uint8 CanTp_DlcLength[CAN_FD_MAX_LEN + 1] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 12, 12, 12, 16, 16, 16,
+    16, 20, 20, 20, 20, 24, 24, 24, 24, 32, 32, 32, 32, 32, 32, 32,
+    32, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    48, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64
+};
+
+static inline uint8 CanTp_FrameLen(uint8 maxFrameLen){
+    uint8 frameLen = maxFrameLen;
+    if (frameLen == 0){
+        frameLen = CANTP_CAN_FRAME_SIZE;
+    } 
+    else if (frameLen < CAN_2_0_MAX_LEN){
+        frameLen = CAN_2_0_MAX_LEN;
+    } 
+    else if (frameLen > CAN_FD_MAX_LEN){
+        frameLen = CAN_FD_MAX_LEN;
+    }
+    // Full frames have to match a DLC, lengths in between are cut to the DLC below
+    while (CanTp_DlcLength[frameLen] != frameLen){
+        frameLen--;
+    }
+    return frameLen;
+}
+
+/**
+  @brief Pads the frame of len bytes in buf and returns the length to send
+
+  With padding on (padLen 8) frames are filled up to 8 bytes. CAN FD frames above 8 bytes are filled
+  up to the next DLC only, padding on or off.
+*/
+static inline PduLengthType CanTp_PadFrame(uint8 *buf, PduLengthType len, uint8 padLen){
+    PduLengthType frameLen = CanTp_DlcLength[len];
+
+    if (frameLen < padLen){
+        frameLen = padLen;
+    }
+    for (PduLengthType byteItr = len; byteItr < frameLen; byteItr++){
+        buf[byteItr] = CONFIG_CANTP_PADDING_BYTE;
+    }
+    return frameLen;
 }
 
+
 static inline uint8 CanTp_GetAddrFieldLen(const CanTp_AddressingFormatType af){
     uint8 extAddrFieldLen = 0;
     switch (af){
@@ -253,45 +640,714 @@ static inline uint8 CanTp_GetAddrFieldLen(const CanTp_AddressingFormatType af){
     return extAddrFieldLen;
 }
 
-static inline PduLengthType CanTp_DecodeFrameDL(const CanTp_PciType frameType, const CanTp_PaddingActivationType padding, const uint8 *sdu){
+// Frames up to 8 bytes carry SF_DL in the N_PCI byte, longer (CAN FD) frames use the escape sequence
+static inline PduLengthType CanTp_MaxSFPayload(uint8 frameLen, uint8 addrFieldLen){
+    uint8 pciSize = (frameLen > CAN_2_0_MAX_LEN) ? CANTP_SF_ESC_PCI_SIZE : CANTP_SF_PCI_SIZE;
+    return (PduLengthType)(frameLen - pciSize - addrFieldLen);
+}
+
+static inline PduLengthType CanTp_CFPayload(uint8 frameLen, uint8 addrFieldLen){
+    return (PduLengthType)(frameLen - CANTP_CF_PCI_SIZE - addrFieldLen);
+}
+
+static CanTp_FrameLayout CanTp_FrameLayoutOf(CanTp_AddressingFormatType af, uint8 maxFrameLen, CanTp_PaddingActivationType padding){
+    CanTp_FrameLayout layout;
+
+    layout.frameLen = CanTp_FrameLen(maxFrameLen);
+    layout.nAe = CanTp_GetAddrFieldLen(af);
+    layout.sfPayload = (uint8)CanTp_MaxSFPayload(layout.frameLen, layout.nAe);
+    layout.cfPayload = (uint8)CanTp_CFPayload(layout.frameLen, layout.nAe);
+    layout.padLen = (padding == CANTP_ON) ? CAN_2_0_MAX_LEN : 0;
+    // FC N_PCI is FS, BS and STmin
+    layout.fcLen = layout.nAe + 3U;
+    layout.txAddr = 0;
+    layout.rxAddr = 0;
+    layout.checkAddr = FALSE;
+    layout.canIdAddr = (af == CANTP_NORMALFIXED) || (af == CANTP_MIXED29BIT);
+    return layout;
+}
+
+/**
+  @brief Sets the address bytes of a layout
+
+  Extended addressing uses the given N_TA / N_SA bytes, mixed addressing N_AE both ways.
+  Without a configured address received frames are not checked and 0 is sent.
+*/
+static void CanTp_LayoutAddress(CanTp_FrameLayout *layout, CanTp_AddressingFormatType af, const uint8 *rxAddr,
+                                const uint8 *txAddr, const CanTp_NAeType *pNAe){
+    if (layout->nAe == 0){
+        return;
+    }
+    if (af != CANTP_EXTENDED){
+        rxAddr = (pNAe != NULL) ? &pNAe->nAe : NULL;
+        txAddr = rxAddr;
+    }
+    layout->checkAddr = (rxAddr != NULL);
+    layout->rxAddr = (rxAddr != NULL) ? *rxAddr : 0U;
+    layout->txAddr = (txAddr != NULL) ? *txAddr : 0U;
+}
+
+static CanTp_FrameLayout CanTp_RxLayoutOf(const CanTp_RxNSduType *nsdu){
+    CanTp_FrameLayout layout = CanTp_FrameLayoutOf(nsdu->addressingFormat, nsdu->maxFrameLen, nsdu->paddingActivation);
+    // Received frames carry N_TA, FC are sent with N_SA
+    CanTp_LayoutAddress(&layout, nsdu->addressingFormat, (nsdu->pNTa != NULL) ? &nsdu->pNTa->nTa : NULL,
+                        (nsdu->pNSa != NULL) ? &nsdu->pNSa->nSa : NULL, nsdu->pNAe);
+    return layout;
+}
+
+static CanTp_FrameLayout CanTp_TxLayoutOf(const CanTp_TxNSduType *nsdu){
+    CanTp_FrameLayout layout = CanTp_FrameLayoutOf(nsdu->addressingFormat, nsdu->maxFrameLen, nsdu->paddingActivation);
+    // Sent frames carry N_TA, FC are received with N_SA
+    CanTp_LayoutAddress(&layout, nsdu->addressingFormat, (nsdu->pNSa != NULL) ? &nsdu->pNSa->nSa : NULL,
+                        (nsdu->pNTa != NULL) ? &nsdu->pNTa->nTa : NULL, nsdu->pNAe);
+    return layout;
+}
+
+static uint8 *CanTp_FrameBufferAlloc(uint32 *poolUsed, uint32 size){
+    uint8 *buf = NULL;
+    if ((*poolUsed + size) <= ARR_SIZE(CanTp_State.frameBufferPool)){
+        buf = &CanTp_State.frameBufferPool[*poolUsed];
+        *poolUsed += size;
+    } 
+    else{
+        Det_ReportRuntimeError(CANTP_MODULE_ID, 0, CANTP_INIT_API_ID, CANTP_E_INIT_FAILED);
+    }
+    return buf;
+}
+
+/**
+  @brief Carves the buffers of the pooled connections
+
+  A connection may be bound to any NSdu, so each buffer is sized for the NSdu needing the largest one.
+  Tx connections get a whole frame and rx connections an FC frame, which always fits into a CAN 2.0 frame,
+  the module can not run without them. The staging, reassembly and FF buffers are optional, a connection
+  the pool could not hold them for works without.
+*/
+static boolean CanTp_AllocFrameBuffers(void){
+    uint32 poolUsed = 0;
+    uint8 frameLen = 0;
+    uint8 ffLen = 0;
+    uint16 stagingSize = 0;
+    uint16 reassemblySize = 0;
+
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.txNSdus); connItr++){
+        const CanTp_TxNSduType *nsdu = CanTp_State.txNSdus[connItr].nsdu;
+        if (nsdu != NULL){
+            frameLen = (CanTp_FrameLen(nsdu->maxFrameLen) > frameLen) ? CanTp_FrameLen(nsdu->maxFrameLen) : frameLen;
+            stagingSize = (nsdu->txStagingSize > stagingSize) ? nsdu->txStagingSize : stagingSize;
+        }
+    }
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxNSdus); connItr++){
+        const CanTp_RxNSduType *nsdu = CanTp_State.rxNSdus[connItr].nsdu;
+        if ((nsdu != NULL) && (nsdu->wftMax != 0)){
+            ffLen = (CanTp_FrameLen(nsdu->maxFrameLen) > ffLen) ? CanTp_FrameLen(nsdu->maxFrameLen) : ffLen;
+        }
+        if (nsdu != NULL){
+            reassemblySize = (nsdu->rxReassemblySize > reassemblySize) ? nsdu->rxReassemblySize : reassemblySize;
+        }
+    }
+
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.txConnections); connItr++){
+        CanTp_State.txConnections[connItr].buf.data = CanTp_FrameBufferAlloc(&poolUsed, frameLen);
+        if (CanTp_State.txConnections[connItr].buf.data == NULL){
+            return FALSE;
+        }
+    }
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxConnections); connItr++){
+        CanTp_State.rxConnections[connItr].fcBuf.data = CanTp_FrameBufferAlloc(&poolUsed, CAN_2_0_MAX_LEN);
+        if (CanTp_State.rxConnections[connItr].fcBuf.data == NULL){
+            return FALSE;
+        }
+    }
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.txConnections); connItr++){
+        CanTp_State.txConnections[connItr].staging.data = (stagingSize != 0) ? CanTp_FrameBufferAlloc(&poolUsed, stagingSize) : NULL;
+    }
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxConnections); connItr++){
+        CanTp_RxConnection *conn = &CanTp_State.rxConnections[connItr];
+        conn->reassembly.data = (reassemblySize != 0) ? CanTp_FrameBufferAlloc(&poolUsed, reassemblySize) : NULL;
+        conn->ffBuf = (ffLen != 0) ? CanTp_FrameBufferAlloc(&poolUsed, ffLen) : NULL;
+    }
+    return TRUE;
+}
+
+static void CanTp_BuildPduIndexes(void){
+    PduIdType minId = 0xFFFFU;
+    PduIdType maxId = 0;
+
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxNSdus); connItr++){
+        const CanTp_RxNSduType *nsdu = CanTp_State.rxNSdus[connItr].nsdu;
+        if (nsdu != NULL){
+            minId = (nsdu->id < minId) ? nsdu->id : minId;
+            maxId = (nsdu->id > maxId) ? nsdu->id : maxId;
+        }
+    }
+    CanTp_PduIndexReset(&CanTp_State.rxIndex, CanTp_State.rxIndexEntries, ARR_SIZE(CanTp_State.rxIndexEntries), minId, maxId);
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxNSdus); connItr++){
+        if (CanTp_State.rxNSdus[connItr].nsdu != NULL){
+            CanTp_PduIndexInsert(&CanTp_State.rxIndex, CanTp_State.rxNSdus[connItr].nsdu->id, (uint16)connItr);
+        }
+    }
+
+    minId = 0xFFFFU;
+    maxId = 0;
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.txNSdus); connItr++){
+        const CanTp_TxNSduType *nsdu = CanTp_State.txNSdus[connItr].nsdu;
+        if (nsdu != NULL){
+            minId = (nsdu->id < minId) ? nsdu->id : minId;
+            maxId = (nsdu->id > maxId) ? nsdu->id : maxId;
+        }
+    }
+    CanTp_PduIndexReset(&CanTp_State.txIndex, CanTp_State.txIndexEntries, ARR_SIZE(CanTp_State.txIndexEntries), minId, maxId);
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.txNSdus); connItr++){
+        if (CanTp_State.txNSdus[connItr].nsdu != NULL){
+            CanTp_PduIndexInsert(&CanTp_State.txIndex, CanTp_State.txNSdus[connItr].nsdu->id, (uint16)connItr);
+        }
+    }
+
+    // Always hashed, the keys are spread over the whole N-PDU id range
+    uint32 addrCount = 0;
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxNSdus); connItr++){
+        const CanTp_RxNSduSlot *slot = &CanTp_State.rxNSdus[connItr];
+        addrCount += ((slot->nsdu != NULL) && (slot->nsdu->rxNPdu != NULL) && CanTp_RxLayoutOf(slot->nsdu).checkAddr) ? 1U : 0U;
+    }
+    CanTp_PduIndexReset(&CanTp_State.rxAddrIndex, CanTp_State.rxAddrIndexEntries, (addrCount != 0) ? ARR_SIZE(CanTp_State.rxAddrIndexEntries) : 0, 0, 0xFFFFFFFFU);
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxNSdus) && (addrCount != 0); connItr++){
+        const CanTp_RxNSduSlot *slot = &CanTp_State.rxNSdus[connItr];
+        if ((slot->nsdu != NULL) && (slot->nsdu->rxNPdu != NULL)){
+            CanTp_FrameLayout layout = CanTp_RxLayoutOf(slot->nsdu);
+            if (layout.checkAddr){
+                CanTp_PduIndexInsert(&CanTp_State.rxAddrIndex, CANTP_ADDR_KEY(slot->nsdu->rxNPdu->id, layout.rxAddr), (uint16)connItr);
+            }
+        }
+    }
+}
+
+/**
+  @brief Checks that no shared rx N-PDU id is the id of an NSdu received on another N-PDU
+
+  CanTp_RxIndication would route a frame on the N-PDU matching none of the addresses to that NSdu.
+*/
+static boolean CanTp_RxNPduIdsValid(void){
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxNSdus); connItr++){
+        const CanTp_RxNSduType *nsdu = CanTp_State.rxNSdus[connItr].nsdu;
+        uint16 otherIdx;
+
+        if ((nsdu == NULL) || (nsdu->rxNPdu == NULL)){
+            continue;
+        }
+        otherIdx = CanTp_PduIndexLookup(&CanTp_State.rxIndex, nsdu->rxNPdu->id);
+        if (otherIdx != CANTP_PDU_INDEX_INVALID){
+            const CanTp_RxNSduType *other = CanTp_State.rxNSdus[otherIdx].nsdu;
+            // Only NSdus sharing the same N-PDU may carry its id, any other owner would take over its frames
+            if ((other->rxNPdu == NULL) || (other->rxNPdu->id != nsdu->rxNPdu->id)){
+                Det_ReportRuntimeError(CANTP_MODULE_ID, 0, CANTP_INIT_API_ID, CANTP_E_INIT_FAILED);
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+static CanTp_TxNSduSlot *CanTp_TxNSduLookup(PduIdType PduId){
+    uint16 nsduIdx = CanTp_PduIndexLookup(&CanTp_State.txIndex, PduId);
+    return (nsduIdx != CANTP_PDU_INDEX_INVALID) ? &CanTp_State.txNSdus[nsduIdx] : NULL;
+}
+
+static CanTp_RxNSduSlot *CanTp_RxNSduLookup(PduIdType PduId){
+    uint16 nsduIdx = CanTp_PduIndexLookup(&CanTp_State.rxIndex, PduId);
+    return (nsduIdx != CANTP_PDU_INDEX_INVALID) ? &CanTp_State.rxNSdus[nsduIdx] : NULL;
+}
+
+/**
+  @brief Finds the rx NSdu a received frame belongs to
+
+  NSdus sharing an N-PDU are told apart by the N_TA / N_AE byte in front of the N_PCI. Other frames are
+  looked up by PduId, and ignored if that NSdu configures a different address.
+*/
+static CanTp_RxNSduSlot *CanTp_RxNSduDemux(PduIdType PduId, const PduInfoType *PduInfoPtr){
+    CanTp_RxNSduSlot *slot;
+    uint16 nsduIdx;
+
+    if ((CanTp_State.rxAddrIndex.size != 0) && (PduInfoPtr->SduLength != 0)){
+        nsduIdx = CanTp_PduIndexLookup(&CanTp_State.rxAddrIndex, CANTP_ADDR_KEY(PduId, PduInfoPtr->SduDataPtr[0]));
+        if (nsduIdx != CANTP_PDU_INDEX_INVALID){
+            return &CanTp_State.rxNSdus[nsduIdx];
+        }
+    }
+
+    slot = CanTp_RxNSduLookup(PduId);
+    if ((slot != NULL) && (CanTp_GetAddrFieldLen(slot->nsdu->addressingFormat) != 0)){
+        CanTp_FrameLayout layout = CanTp_RxLayoutOf(slot->nsdu);
+        if (layout.checkAddr && ((PduInfoPtr->SduLength == 0) || (PduInfoPtr->SduDataPtr[0] != layout.rxAddr))){
+            slot = NULL;
+        }
+    }
+    return slot;
+}
+
+// BS and STmin of the NSdu a reception is bound to, they can not change while it is bound
+static inline const CanTp_RxNSduSlot *CanTp_RxParams(const CanTp_RxConnection *conn){
+    return &CanTp_State.rxNSdus[conn->nsduIdx];
+}
+
+// Connection bound to the NSdu, NULL if there is no transfer in progress
+static CanTp_TxConnection *getTxConnection(PduIdType PduId){
+    const CanTp_TxNSduSlot *slot = CanTp_TxNSduLookup(PduId);
+    return ((slot != NULL) && (slot->connIdx != CANTP_PDU_INDEX_INVALID)) ? &CanTp_State.txConnections[slot->connIdx] : NULL;
+}
+
+static CanTp_RxConnection *getRxConnection(PduIdType PduId){
+    const CanTp_RxNSduSlot *slot = CanTp_RxNSduLookup(PduId);
+    return ((slot != NULL) && (slot->connIdx != CANTP_PDU_INDEX_INVALID)) ? &CanTp_State.rxConnections[slot->connIdx] : NULL;
+}
+
+// CanIf PduId the FCs of a reception are sent with and confirmed by
+static inline PduIdType CanTp_RxFcPduId(const CanTp_RxNSduType *nsdu){
+    return (nsdu->txFcNPdu != NULL) ? (PduIdType)nsdu->txFcNPdu->nPduConfirmationPduId : nsdu->id;
+}
+
+static inline void CanTp_RxSetFcPending(CanTp_RxConnection *conn, boolean pending){
+    if (conn->fcPending != pending){
+        conn->fcPending = pending;
+        if (pending){
+            CanTp_State.rxFcPendingCount++;
+        } 
+        else{
+            CanTp_State.rxFcPendingCount--;
+        }
+    }
+}
+
+// Reception whose FC sent with PduId was handed to CanIf first and is not confirmed yet, NULL if there is none
+static CanTp_RxConnection *CanTp_RxFcPendingConnection(PduIdType PduId){
+    CanTp_RxConnection *oldest = NULL;
+
+    if (CanTp_State.rxFcPendingCount == 0){
+        return NULL;
+    }
+    for (uint32 activeItr = 0; activeItr < CanTp_State.rxActiveCount; activeItr++){
+        CanTp_RxConnection *conn = &CanTp_State.rxConnections[CanTp_State.rxActive[activeItr]];
+        if (conn->fcPending && (CanTp_RxFcPduId(conn->nsdu) == PduId) &&
+            ((oldest == NULL) || ((sint32)(conn->fcSeq - oldest->fcSeq) < 0))){
+            oldest = conn;
+        }
+    }
+    return oldest;
+}
+
+static void CanTp_ConnectionPoolsReset(void){
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxConnections); connItr++){
+        CanTp_State.rxActive[connItr] = (uint16)connItr;
+        CanTp_State.rxConnections[connItr].activeSlot = (uint16)connItr;
+        CanTp_State.rxConnections[connItr].fcPending = FALSE;
+    }
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.txConnections); connItr++){
+        CanTp_State.txActive[connItr] = (uint16)connItr;
+        CanTp_State.txConnections[connItr].activeSlot = (uint16)connItr;
+    }
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxNSdus); connItr++){
+        CanTp_State.rxNSdus[connItr].connIdx = CANTP_PDU_INDEX_INVALID;
+    }
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.txNSdus); connItr++){
+        CanTp_State.txNSdus[connItr].connIdx = CANTP_PDU_INDEX_INVALID;
+    }
+    CanTp_State.rxActiveCount = 0;
+    CanTp_State.txActiveCount = 0;
+    CanTp_State.rxFcPendingCount = 0;
+    CanTp_PduIndexReset(&CanTp_State.rxPeerIndex, CanTp_State.rxPeerIndexEntries, ARR_SIZE(CanTp_State.rxPeerIndexEntries), 0, 0xFFFFFFFFU);
+    CanTp_State.rxPoolStats = (CanTp_PoolStatsType){.size = (uint16)CANTP_RX_CONNECTIONS_COUNT};
+    CanTp_State.txPoolStats = (CanTp_PoolStatsType){.size = (uint16)CANTP_TX_CONNECTIONS_COUNT};
+}
+
+/**
+  @brief Connection pools
+
+  The first free entry of the permutation is taken on binding. Releasing swaps the connection with the last
+  bound one, so both operations are O(1) and the bound connections stay densely packed for CanTp_MainFunction.
+*/
+static CanTp_TxConnection *CanTp_TxBind(CanTp_TxNSduSlot *slot){
+    CanTp_TxConnection *conn;
+    uint16 connIdx;
+
+    if (CanTp_State.txActiveCount >= ARR_SIZE(CanTp_State.txConnections)){
+        CanTp_State.txPoolStats.exhaustedCount++;
+        return NULL;
+    }
+    connIdx = CanTp_State.txActive[CanTp_State.txActiveCount];
+    conn = &CanTp_State.txConnections[connIdx];
+    conn->activeSlot = (uint16)CanTp_State.txActiveCount++;
+    if (CanTp_State.txActiveCount > CanTp_State.txPoolStats.peakInUse){
+        CanTp_State.txPoolStats.peakInUse = (uint16)CanTp_State.txActiveCount;
+    }
+
+    slot->connIdx = connIdx;
+    conn->nsduIdx = (uint16)(slot - CanTp_State.txNSdus);
+    conn->nsdu = slot->nsdu;
+    conn->channel = slot->channel;
+    conn->layout = CanTp_TxLayoutOf(slot->nsdu);
+    conn->staging.size = (conn->staging.data != NULL) ? slot->nsdu->txStagingSize : 0;
+    CANTP_TX_ACTIVATION(conn) = CANTP_TX_WAIT;
+    CANTP_TX_STATE(conn) = CANTP_TX_STATE_FREE;
+    return conn;
+}
+
+static void CanTp_TxRelease(CanTp_TxConnection *conn){
+    uint16 connIdx = (uint16)(conn - CanTp_State.txConnections);
+    uint16 lastIdx;
+
+    if ((conn->activeSlot >= CanTp_State.txActiveCount) || (CanTp_State.txActive[conn->activeSlot] != connIdx)){
+        return;
+    }
+    lastIdx = CanTp_State.txActive[--CanTp_State.txActiveCount];
+    CanTp_State.txActive[conn->activeSlot] = lastIdx;
+    CanTp_State.txConnections[lastIdx].activeSlot = conn->activeSlot;
+    CanTp_State.txActive[CanTp_State.txActiveCount] = connIdx;
+    conn->activeSlot = (uint16)CanTp_State.txActiveCount;
+    CanTp_State.txNSdus[conn->nsduIdx].connIdx = CANTP_PDU_INDEX_INVALID;
+}
+
+static CanTp_RxConnection *CanTp_RxTakeFree(CanTp_RxNSduSlot *slot){
+    CanTp_RxConnection *conn;
+    uint16 connIdx = CanTp_State.rxActive[CanTp_State.rxActiveCount];
+
+    conn = &CanTp_State.rxConnections[connIdx];
+    conn->activeSlot = (uint16)CanTp_State.rxActiveCount++;
+    if (CanTp_State.rxActiveCount > CanTp_State.rxPoolStats.peakInUse){
+        CanTp_State.rxPoolStats.peakInUse = (uint16)CanTp_State.rxActiveCount;
+    }
+
+    // Further receptions of an NSdu addressed by CAN ID are found through CanTp_State.rxPeerIndex
+    if (slot->connIdx == CANTP_PDU_INDEX_INVALID){
+        slot->connIdx = connIdx;
+    }
+    conn->nsduIdx = (uint16)(slot - CanTp_State.rxNSdus);
+    conn->nsdu = slot->nsdu;
+    conn->channel = slot->channel;
+    conn->layout = CanTp_RxLayoutOf(slot->nsdu);
+    conn->reassembly.size = (conn->reassembly.data != NULL) ? slot->nsdu->rxReassemblySize : 0;
+    conn->reassembly.count = 0;
+    conn->peerBound = FALSE;
+    conn->startPending = FALSE;
+    CanTp_RxSetFcPending(conn, FALSE);
+    conn->wftCount = 0;
+    conn->bindTime = CanTp_State.currentTime;
+    CANTP_RX_ACTIVATION(conn) = CANTP_RX_WAIT;
+    CANTP_RX_STATE(conn) = CANTP_RX_STATE_FREE;
+    return conn;
+}
+
+static void CanTp_RxRelease(CanTp_RxConnection *conn){
+    uint16 connIdx = (uint16)(conn - CanTp_State.rxConnections);
+    uint16 lastIdx;
+
+    if ((conn->activeSlot >= CanTp_State.rxActiveCount) || (CanTp_State.rxActive[conn->activeSlot] != connIdx)){
+        return;
+    }
+    lastIdx = CanTp_State.rxActive[--CanTp_State.rxActiveCount];
+    CanTp_State.rxActive[conn->activeSlot] = lastIdx;
+    CanTp_State.rxConnections[lastIdx].activeSlot = conn->activeSlot;
+    CanTp_State.rxActive[CanTp_State.rxActiveCount] = connIdx;
+    conn->activeSlot = (uint16)CanTp_State.rxActiveCount;
+    if (CanTp_State.rxNSdus[conn->nsduIdx].connIdx == connIdx){
+        CanTp_State.rxNSdus[conn->nsduIdx].connIdx = CANTP_PDU_INDEX_INVALID;
+        // Other testers may still be receiving on the NSdu (fixed/mixed addressing), the slot refers to one of them
+        for (uint32 activeItr = 0; activeItr < CanTp_State.rxActiveCount; activeItr++){
+            uint16 otherIdx = CanTp_State.rxActive[activeItr];
+            if ((CanTp_State.rxConnections[otherIdx].nsduIdx == conn->nsduIdx) && (CANTP_RX_STATE_AT(otherIdx) != CANTP_RX_STATE_ABORT)){
+                CanTp_State.rxNSdus[conn->nsduIdx].connIdx = otherIdx;
+                break;
+            }
+        }
+    }
+    // A released reception no longer waits for its FC
+    CanTp_RxSetFcPending(conn, FALSE);
+    if (conn->peerBound){
+        CanTp_PduIndexRemove(&CanTp_State.rxPeerIndex, CANTP_ADDR_KEY(conn->nsduIdx, conn->peerAddr));
+        conn->peerBound = FALSE;
+    }
+}
+
+/**
+  @brief Timer engine
+
+  Deadlines are absolute values of CanTp_State.currentTime. Armed timers are hashed into the wheel by the period
+  in which they expire, so CanTp_MainFunction only inspects the bucket of the current period.
+*/
+static void CanTp_TimerStop(uint16 timerIdx){
+    CanTp_Timer *timer = &CanTp_State.timers[timerIdx];
+
+    if (timer->type == CANTP_TIMER_NONE){
+        return;
+    }
+    if (timer->prev != 0){
+        CanTp_State.timers[timer->prev - 1].next = timer->next;
+    } 
+    else{
+        CanTp_State.timerWheel[(timer->deadline / CONFIG_CANTP_MAIN_FUNCTION_PERIOD) % CONFIG_CANTP_TIMER_WHEEL_SIZE] = timer->next;
+    }
+    if (timer->next != 0){
+        CanTp_State.timers[timer->next - 1].prev = timer->prev;
+    }
+    timer->type = CANTP_TIMER_NONE;
+}
+
+static void CanTp_TimerStart(uint16 timerIdx, CanTp_TimerType type, uint32 timeout){
+    CanTp_Timer *timer = &CanTp_State.timers[timerIdx];
+    uint16 *bucket;
+
+    CanTp_TimerStop(timerIdx);
+    // Timeout not configured, connection is not supervised
+    if (timeout == 0){
+        return;
+    }
+
+    // Round up to the period in which the timeout is detected
+    timer->deadline = ((CanTp_State.currentTime + timeout + CONFIG_CANTP_MAIN_FUNCTION_PERIOD - 1) / CONFIG_CANTP_MAIN_FUNCTION_PERIOD) * CONFIG_CANTP_MAIN_FUNCTION_PERIOD;
+    timer->type = type;
+    bucket = &CanTp_State.timerWheel[(timer->deadline / CONFIG_CANTP_MAIN_FUNCTION_PERIOD) % CONFIG_CANTP_TIMER_WHEEL_SIZE];
+
+    timer->prev = 0;
+    timer->next = *bucket;
+    if (*bucket != 0){
+        CanTp_State.timers[*bucket - 1].prev = timerIdx + 1;
+    }
+    *bucket = timerIdx + 1;
+}
+
+static inline uint16 CanTp_RxTimerIdx(const CanTp_RxConnection *conn){
+    return (uint16)(conn - CanTp_State.rxConnections);
+}
+
+static inline uint16 CanTp_TxTimerIdx(const CanTp_TxConnection *conn){
+    return (uint16)(CANTP_RX_CONNECTIONS_COUNT + (uint32)(conn - CanTp_State.txConnections));
+}
+
+// Arms the timeout supervising the given tx state
+static void CanTp_TxArmTimer(CanTp_TxConnection *conn, CanTp_TxConnectionState state){
+    switch (state){
+        case CANTP_TX_STATE_SF_SEND_REQ:
+        case CANTP_TX_STATE_FF_SEND_REQ:
+        case CANTP_TX_STATE_CF_SEND_REQ:
+            CanTp_TimerStart(CanTp_TxTimerIdx(conn), CANTP_TIMER_N_CS, conn->nsdu->ncs);
+            break;
+        case CANTP_TX_STATE_SF_SEND_PROCESS:
+        case CANTP_TX_STATE_FF_SEND_PROCESS:
+        case CANTP_TX_STATE_CF_SEND_PROCESS:
+        case CANTP_TX_STATE_WAIT_CANIF_CONFIRM:
+            CanTp_TimerStart(CanTp_TxTimerIdx(conn), CANTP_TIMER_N_AS, conn->nsdu->nas);
+            break;
+        case CANTP_TX_STATE_WAIT_FC:
+            CanTp_TimerStart(CanTp_TxTimerIdx(conn), CANTP_TIMER_N_BS, conn->nsdu->nbs);
+            break;
+        case CANTP_TX_STATE_FREE:
+        case CANTP_TX_STATE_CANCEL:
+        default:
+            CanTp_TimerStop(CanTp_TxTimerIdx(conn));
+            break;
+    }
+}
+
+// Arms the timeout supervising the given rx state
+static void CanTp_RxArmTimer(CanTp_RxConnection *conn, CanTp_RxConnectionState state){
+    // N_Ar runs until CanIf confirms the FC, the timer of the state is started by the confirmation.
+    // Without N_Ar it starts when the FC is handed to CanIf.
+    if (conn->fcPending && (conn->nsdu->nar != 0) && ((state == CANTP_RX_STATE_WAIT_CF) || (state == CANTP_RX_STATE_FC_TX_REQ) || (state == CANTP_RX_STATE_WAIT_BUFFER))){
+        return;
+    }
+    switch (state){
+        case CANTP_RX_STATE_WAIT_CF:
+            CanTp_TimerStart(CanTp_RxTimerIdx(conn), CANTP_TIMER_N_CR, conn->nsdu->ncr);
+            break;
+        case CANTP_RX_STATE_FC_TX_REQ:
+        case CANTP_RX_STATE_WAIT_BUFFER:
+            CanTp_TimerStart(CanTp_RxTimerIdx(conn), CANTP_TIMER_N_BR, conn->nsdu->nbr);
+            break;
+        case CANTP_RX_STATE_FREE:
+        case CANTP_RX_STATE_PROCESSED:
+        case CANTP_RX_STATE_ABORT:
+        case CANTP_RX_STATE_INVALID:
+        default:
+            CanTp_TimerStop(CanTp_RxTimerIdx(conn));
+            break;
+    }
+}
+
+/**
+  @brief Checks if a transfer in the given direction is running on the channel
+
+  Only the bound connections are visited, a finished reception waiting to be freed does not count.
+*/
+static boolean CanTp_ChannelBusy(const CanTp_ChannelType *channel, CanTp_NSduDirection_t direction){
+    if (direction == CANTP_NSDU_DIRECTION_RX){
+        for (uint32 activeItr = 0; activeItr < CanTp_State.rxActiveCount; activeItr++){
+            const CanTp_RxConnection *conn = &CanTp_State.rxConnections[CanTp_State.rxActive[activeItr]];
+            if ((conn->channel == channel) && (CANTP_RX_ACTIVATION(conn) == CANTP_RX_PROCESSING) &&
+                (CANTP_RX_STATE(conn) != CANTP_RX_STATE_PROCESSED) && (CANTP_RX_STATE(conn) != CANTP_RX_STATE_ABORT)){
+                return TRUE;
+            }
+        }
+    } 
+    else{
+        for (uint32 activeItr = 0; activeItr < CanTp_State.txActiveCount; activeItr++){
+            const CanTp_TxConnection *conn = &CanTp_State.txConnections[CanTp_State.txActive[activeItr]];
+            if ((conn->channel == channel) && (CANTP_TX_ACTIVATION(conn) == CANTP_TX_PROCESSING)){
+                return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
+
+static void CanTp_TxSetState(CanTp_TxConnection *conn, CanTp_TxConnectionState state){
+    if (state != CANTP_TX_STATE(conn)){
+        CanTp_TxArmTimer(conn, state);
+    }
+    // A finished transfer returns its connection to the pool
+    if (state == CANTP_TX_STATE_FREE){
+        CanTp_TxRelease(conn);
+    }
+    CANTP_TX_STATE(conn) = state;
+}
+
+static void CanTp_RxSetState(CanTp_RxConnection *conn, CanTp_RxConnectionState state){
+    if (state != CANTP_RX_STATE(conn)){
+        CanTp_RxArmTimer(conn, state);
+    }
+    if (state == CANTP_RX_STATE_FREE){
+        CanTp_RxRelease(conn);
+    }
+    CANTP_RX_STATE(conn) = state;
+}
+
+/**
+  @brief Binds a connection for a reception started by SF/FF
+
+  When the pool is exhausted, CONFIG_CANTP_RX_POOL_EXHAUSTION_POLICY either ignores the new frame
+  or aborts the reception that was started first.
+*/
+static CanTp_RxConnection *CanTp_RxBind(CanTp_RxNSduSlot *slot){
+    if (CanTp_State.rxActiveCount < ARR_SIZE(CanTp_State.rxConnections)){
+        return CanTp_RxTakeFree(slot);
+    }
+    CanTp_State.rxPoolStats.exhaustedCount++;
+
+#if (CONFIG_CANTP_RX_POOL_EXHAUSTION_POLICY == CANTP_POOL_EVICT_OLDEST)
+    CanTp_RxConnection *oldest = NULL;
+    for (uint32 activeItr = 0; activeItr < CanTp_State.rxActiveCount; activeItr++){
+        CanTp_RxConnection *conn = &CanTp_State.rxConnections[CanTp_State.rxActive[activeItr]];
+        if ((oldest == NULL) || ((sint32)(conn->bindTime - oldest->bindTime) < 0)){
+            oldest = conn;
+        }
+    }
+    if (CANTP_RX_ACTIVATION(oldest) == CANTP_RX_PROCESSING){
+        PduR_CanTpRxIndication(oldest->nsdu->id, E_NOT_OK);
+    }
+    CANTP_RX_ACTIVATION(oldest) = CANTP_RX_WAIT;
+    CanTp_RxSetState(oldest, CANTP_RX_STATE_FREE);
+    CanTp_State.rxPoolStats.evictedCount++;
+    return CanTp_RxTakeFree(slot);
+#else
+    return NULL;
+#endif
+}
+
+static inline CanTp_PciType CanTp_DecodeFrameType(const uint8 *sdu){
+    return (((sdu[0]) >> 4) & 0xF);
+}
+
+/**
+  @brief Decodes SF_DL / FF_DL
+
+  sdu points to the N_PCI and sduLength is the number of bytes from there to the end of the N_PDU.
+  pciSize receives the N_PCI length including escape sequences. A returned DL of 0 marks an invalid frame.
+*/
+static inline PduLengthType CanTp_DecodeFrameDL(const CanTp_PciType frameType, const uint8 *sdu, PduLengthType sduLength, uint8 addrFieldLen, uint8 *pciSize){
     PduLengthType dl = 0;
     if (frameType == CANTP_N_PCI_TYPE_SF) {
         dl = sdu[0] & 0x0F;
-#if defined(CONFIG_CAN_FD_ONLY)
-        if (dl == 0) {
+        *pciSize = CANTP_SF_PCI_SIZE;
+        // SF_DL escape sequence, only in CAN FD frames longer than 8 bytes.
+        // An escaped SF_DL which would fit into the N_PCI byte of an 8 byte frame is invalid
+        if ((dl == 0) && (sduLength + addrFieldLen > CAN_2_0_MAX_LEN)) {
             dl = sdu[1];
+            *pciSize = CANTP_SF_ESC_PCI_SIZE;
+            if (dl <= (PduLengthType)(CAN_2_0_MAX_LEN - CANTP_SF_PCI_SIZE - addrFieldLen)){
+                dl = 0;
+            }
+        }
+        if ((PduLengthType)*pciSize + dl > sduLength){
+            dl = 0;
         }
-#endif
     } 
     else if (frameType == CANTP_N_PCI_TYPE_FF) {
-        dl = ((PduLengthType)(sdu[0] & 0x0f) << 8) || (PduLengthType)(sdu[1]);
-
-        if (dl == 0){
-            dl = ((PduLengthType)(sdu[2]) << 24) || ((PduLengthType)(sdu[3]) << 16) || ((PduLengthType)(sdu[4]) << 8) || (PduLengthType)(sdu[5]);
+        dl = ((PduLengthType)(sdu[0] & 0x0F) << 8) | (PduLengthType)(sdu[1]);
+        *pciSize = CANTP_FF_PCI_SIZE;
+
+        // FF_DL escape sequence for messages longer than 4095 bytes, a shorter escaped FF_DL is invalid
+        if ((dl == 0) && (sduLength >= CANTP_FF_ESC_PCI_SIZE)){
+            dl = ((PduLengthType)(sdu[2]) << 24) | ((PduLengthType)(sdu[3]) << 16) | ((PduLengthType)(sdu[4]) << 8) | (PduLengthType)(sdu[5]);
+            *pciSize = CANTP_FF_ESC_PCI_SIZE;
+            if (dl <= CANTP_FF_DL_12BIT_MAX){
+                dl = 0;
+            }
         }
     } 
     else{
         // CF & FC doesn't have DL
+        *pciSize = CANTP_CF_PCI_SIZE;
     }
     return dl;
 }
 
-static uint32 determineMaxTxNsduLength(CanTp_TxNSduType *nsdu){
-    uint32 maxLen = 0;
-#if defined(CONFIG_CAN_2_0_OR_CAN_FD)
-    maxLen = CAN_2_0_MAX_LEN - CANTP_SF_PCI_SIZE - CanTp_GetAddrFieldLen(nsdu->addressingFormat);
-#elif defined(CONFIG_CAN_FD_ONLY)
-    maxLen = CAN_FD_MAX_LEN - 2 - CanTp_GetAddrFieldLen(nsdu->addressingFormat);
-#endif
-    return maxLen;
+static inline uint32 CanTp_MetaDataToCanId(const uint8 *metaData){
+    return (uint32)metaData[0] | ((uint32)metaData[1] << 8) | ((uint32)metaData[2] << 16) | ((uint32)metaData[3] << 24);
+}
+
+static inline void CanTp_CanIdToMetaData(uint32 canId, uint8 *metaData){
+    metaData[0] = (uint8)canId;
+    metaData[1] = (uint8)(canId >> 8);
+    metaData[2] = (uint8)(canId >> 16);
+    metaData[3] = (uint8)(canId >> 24);
+}
+
+// 29 bit CAN ID of normal fixed or mixed 29 bit addressing
+static inline uint32 CanTp_FixedCanId(CanTp_AddressingFormatType af, CanTp_TaTypeType taType, uint8 nTa, uint8 nSa){
+    uint32 pf;
+
+    if (af == CANTP_MIXED29BIT){
+        pf = (taType == CANTP_FUNCTIONAL) ? CANTP_PF_MIXED29_FUNCTIONAL : CANTP_PF_MIXED29_PHYSICAL;
+    } 
+    else{
+        pf = (taType == CANTP_FUNCTIONAL) ? CANTP_PF_NORMALFIXED_FUNCTIONAL : CANTP_PF_NORMALFIXED_PHYSICAL;
+    }
+    return CANTP_FIXED_CAN_ID_PRIORITY | (pf << 16) | ((uint32)nTa << 8) | (uint32)nSa;
+}
+
+// Converts STmin (ISO 15765-2 encoding) to MainFunction periods, rounding up
+static uint32 CanTp_StMinToPeriods(uint8 stMin){
+    uint32 stMinUs;
+
+    if (stMin <= 0x7FU){
+        stMinUs = (uint32)stMin * 1000U;
+    } 
+    else if ((stMin >= 0xF1U) && (stMin <= 0xF9U)){
+        stMinUs = (uint32)(stMin - 0xF0U) * 100U;
+    } 
+    else{
+        // Reserved values shall be handled as the maximum STmin
+        stMinUs = 0x7FU * 1000U;
+    }
+    return (stMinUs + (CONFIG_CANTP_MAIN_FUNCTION_PERIOD * 1000U) - 1U) / (CONFIG_CANTP_MAIN_FUNCTION_PERIOD * 1000U);
+}
+
+static uint32 determineMaxTxNsduLength(const CanTp_TxConnection *conn){
+    return conn->layout.sfPayload;
 }
 
 static PduLengthType CanTp_GetRxBS(const CanTp_RxConnection *conn){
     PduLengthType result;
-    const PduLengthType payloadSize =
-        CANTP_CAN_FRAME_SIZE -
-        (CANTP_N_PCI_TYPE_CF + CanTp_GetAddrFieldLen(conn->nsdu->addressingFormat));
-    const PduLengthType fullBs = conn->nsdu->bs * payloadSize;
+    const PduLengthType payloadSize = conn->layout.cfPayload;
+    const PduLengthType fullBs = CanTp_RxParams(conn)->bs * payloadSize;
     const PduLengthType lastBs = conn->buffSize;
 
     if ((lastBs < fullBs) || (fullBs == 0x00u)){
@@ -303,6 +1359,40 @@ static PduLengthType CanTp_GetRxBS(const CanTp_RxConnection *conn){
     return result;
 }
 
+/**
+  @brief Decides FS and BS of the next FC
+
+  With adaptiveBs the block is sized to the buffer PduR reported in aquiredBuffSize, at most the configured BS,
+  and FC.WAIT is only sent when not even one CF fits. Otherwise the configured BS is used and FC.WAIT is sent
+  until a whole block fits.
+*/
+static void CanTp_RxPrepareFC(CanTp_RxConnection *conn){
+    const PduLengthType cfPayload = conn->layout.cfPayload;
+    const uint32 maxBs = (CanTp_RxParams(conn)->bs != 0) ? CanTp_RxParams(conn)->bs : 0xFFU;
+    uint32 cfCount;
+
+    conn->fs = CANTP_FS_TYPE_CTS;
+    if (!conn->nsdu->adaptiveBs){
+        conn->blockSize = CanTp_RxParams(conn)->bs;
+        if (conn->aquiredBuffSize < CanTp_GetRxBS(conn)){
+            conn->fs = CANTP_FS_TYPE_WT;
+        }
+    } 
+    else if (conn->aquiredBuffSize >= conn->buffSize){
+        // The rest of the message fits, only the configured BS can require another FC
+        cfCount = (conn->buffSize + cfPayload - 1U) / cfPayload;
+        conn->blockSize = ((CanTp_RxParams(conn)->bs == 0) || (cfCount <= maxBs)) ? 0 : (uint8)maxBs;
+    } 
+    else{
+        cfCount = conn->aquiredBuffSize / cfPayload;
+        if (cfCount == 0){
+            conn->fs = CANTP_FS_TYPE_WT;
+        }
+        conn->blockSize = (uint8)((cfCount < maxBs) ? cfCount : maxBs);
+    }
+    conn->bs = conn->blockSize;
+}
+
 static BufReq_ReturnType CanTp_CopyRxData(CanTp_RxConnection *rxConn){
     BufReq_ReturnType result;
 
@@ -315,24 +1405,116 @@ static BufReq_ReturnType CanTp_CopyRxData(CanTp_RxConnection *rxConn){
     return result;
 }
 
+/**
+  @brief Passes the CF payload in conn->pduInfo to PduR
+
+  With a reassembly buffer the payload is only appended to it. The buffer is handed over when flush is set
+  (end of a block or of the message) or when it cannot take another CF.
+*/
+static BufReq_ReturnType CanTp_RxStoreCF(CanTp_RxConnection *conn, boolean flush){
+    CanTp_RxReassembly *reassembly = &conn->reassembly;
+    BufReq_ReturnType result = BUFREQ_OK;
+    PduLengthType cfPayload = conn->layout.cfPayload;
+
+    if ((reassembly->data == NULL) || (conn->pduInfo.SduLength > (PduLengthType)(reassembly->size - reassembly->count))){
+        return CanTp_CopyRxData(conn);
+    }
+
+    for (PduLengthType byteItr = 0; byteItr < conn->pduInfo.SduLength; byteItr++){
+        reassembly->data[reassembly->count + byteItr] = conn->pduInfo.SduDataPtr[byteItr];
+    }
+    reassembly->count += (uint16)conn->pduInfo.SduLength;
+
+    if (flush || ((PduLengthType)(reassembly->size - reassembly->count) < cfPayload)){
+        conn->pduInfo.SduDataPtr = reassembly->data;
+        conn->pduInfo.SduLength = reassembly->count;
+        result = CanTp_CopyRxData(conn);
+        reassembly->count = 0;
+    }
+    return result;
+}
+
+/**
+  @brief Connection of a reception addressed by the CAN ID in metaData
+
+  Each tester N_SA gets its own connection, found through CanTp_State.rxPeerIndex, and SF/FF bind a new one.
+  Frames to another N_TA than the configured one are ignored.
+*/
+static CanTp_RxConnection *CanTp_RxPeerConnection(CanTp_RxNSduSlot *slot, const uint8 *metaData, CanTp_PciType frameType){
+    uint32 canId = CanTp_MetaDataToCanId(metaData);
+    uint8 nSa = (uint8)canId;
+    uint8 nTa = (uint8)(canId >> 8);
+    uint16 nsduIdx = (uint16)(slot - CanTp_State.rxNSdus);
+    uint16 connIdx;
+    CanTp_RxConnection *conn;
+
+    if ((slot->nsdu->pNTa != NULL) && (slot->nsdu->pNTa->nTa != nTa)){
+        return NULL;
+    }
+    connIdx = CanTp_PduIndexLookup(&CanTp_State.rxPeerIndex, CANTP_ADDR_KEY(nsduIdx, nSa));
+    if (connIdx != CANTP_PDU_INDEX_INVALID){
+        return &CanTp_State.rxConnections[connIdx];
+    }
+    if ((frameType != CANTP_N_PCI_TYPE_SF) && (frameType != CANTP_N_PCI_TYPE_FF)){
+        return NULL;
+    }
+
+    conn = CanTp_RxBind(slot);
+    if (conn == NULL){
+        return NULL;
+    }
+    conn->peerAddr = nSa;
+    conn->peerBound = TRUE;
+    for (uint8 byteItr = 0; byteItr < CANTP_CAN_ID_32_LEN; byteItr++){
+        conn->metaData[byteItr] = metaData[byteItr];
+    }
+    // FC goes back from the addressed N_TA to the tester
+    CanTp_CanIdToMetaData(CanTp_FixedCanId(slot->nsdu->addressingFormat, CANTP_PHYSICAL, nSa, nTa), conn->fcMetaData);
+    CanTp_PduIndexInsert(&CanTp_State.rxPeerIndex, CANTP_ADDR_KEY(nsduIdx, nSa), (uint16)(conn - CanTp_State.rxConnections));
+    return conn;
+}
+
+/**
+  @brief Hands the FF payload in conn->pduInfo to PduR once the reception was started
+
+  The buffer only has to take the FF payload, the rest of the message is paced by FC.
+*/
+static CanTp_RxConnectionState CanTp_RxAcceptFF(CanTp_RxConnection *conn){
+    if ((conn->aquiredBuffSize < conn->pduInfo.SduLength) || (CanTp_CopyRxData(conn) != BUFREQ_OK)){
+        PduR_CanTpRxIndication(conn->nsdu->id, E_NOT_OK);
+        return CANTP_RX_STATE_ABORT;
+    }
+    // The FC is based on the buffer left after the FF payload
+    CanTp_RxPrepareFC(conn);
+    return CANTP_RX_STATE_FC_TX_REQ;
+}
+
 static CanTp_RxConnectionState CanTp_RxIndSF(CanTp_RxConnection *conn, const PduInfoType *PduInfoPtr, uint8 nAeSize){
     uint8 headerSize;
+    uint8 pciSize;
+    PduLengthType sfDl;
     BufReq_ReturnType status;
     CanTp_RxConnectionState result = CANTP_RX_STATE_INVALID;
 
+    sfDl = CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_SF, &(PduInfoPtr->SduDataPtr[nAeSize]), PduInfoPtr->SduLength - nAeSize, nAeSize, &pciSize);
+    // Frames with an invalid SF_DL are ignored
+    if (sfDl == 0){
+        return CANTP_RX_STATE(conn);
+    }
+
     // if reception is in progres report it and start new reception
-    if (conn->activation == CANTP_RX_PROCESSING){
+    if (CANTP_RX_ACTIVATION(conn) == CANTP_RX_PROCESSING){
         PduR_CanTpRxIndication(conn->nsdu->id, E_NOT_OK);
     } 
     else{
-        conn->activation = CANTP_RX_PROCESSING;
+        CANTP_RX_ACTIVATION(conn) = CANTP_RX_PROCESSING;
     }
 
-    headerSize = CANTP_SF_PCI_SIZE + nAeSize;
-    conn->buffSize = CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_SF, conn->nsdu->paddingActivation, &(PduInfoPtr->SduDataPtr[nAeSize]));
+    headerSize = pciSize + nAeSize;
+    conn->buffSize = sfDl;
 
     conn->pduInfo.SduDataPtr = &(PduInfoPtr->SduDataPtr[headerSize]);
-    conn->pduInfo.MetaDataPtr = NULL;
+    conn->pduInfo.MetaDataPtr = conn->peerBound ? conn->metaData : NULL;
     conn->pduInfo.SduLength = conn->buffSize;
 
     status = PduR_CanTpStartOfReception(conn->nsdu->id, &conn->pduInfo, conn->buffSize, &conn->aquiredBuffSize);
@@ -366,59 +1548,67 @@ static CanTp_RxConnectionState CanTp_RxIndSF(CanTp_RxConnection *conn, const Pdu
 
 static CanTp_RxConnectionState CanTp_RxIndFF(CanTp_RxConnection *conn, const PduInfoType *PduInfoPtr, uint8 nAeSize){
     uint8 headerSize;
-    uint8 payloadSize;
+    uint8 pciSize;
+    PduLengthType ffDl;
     BufReq_ReturnType status;
     CanTp_RxConnectionState result = CANTP_RX_STATE_INVALID;
 
+    // Frames longer than the ones configured for the NSdu or too short for the FF N_PCI are ignored
+    if ((PduInfoPtr->SduLength > conn->layout.frameLen) || (PduInfoPtr->SduLength < (PduLengthType)nAeSize + CANTP_FF_PCI_SIZE)){
+        return CANTP_RX_STATE(conn);
+    }
+    ffDl = CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_FF, &(PduInfoPtr->SduDataPtr[nAeSize]), PduInfoPtr->SduLength - nAeSize, nAeSize, &pciSize);
+    // FF_DL has to exceed what a single frame can carry, otherwise the FF is ignored
+    if (ffDl <= conn->layout.sfPayload){
+        return CANTP_RX_STATE(conn);
+    }
+
     // if reception is in progres report it and start new reception
-    if (conn->activation == CANTP_RX_PROCESSING){
+    if (CANTP_RX_ACTIVATION(conn) == CANTP_RX_PROCESSING){
         PduR_CanTpRxIndication(conn->nsdu->id, E_NOT_OK);
     } 
     else{
-        conn->activation = CANTP_RX_PROCESSING;
+        CANTP_RX_ACTIVATION(conn) = CANTP_RX_PROCESSING;
     }
 
-    headerSize = CANTP_FF_PCI_SIZE + nAeSize;
-    payloadSize = CANTP_CAN_FRAME_SIZE - headerSize;
+    headerSize = pciSize + nAeSize;
 
-    conn->buffSize = CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_FF, conn->nsdu->paddingActivation, &(PduInfoPtr->SduDataPtr[nAeSize]));
+    conn->buffSize = ffDl;
+    conn->reassembly.count = 0;
     conn->sn = 0;
-    conn->bs = conn->nsdu->bs;
+    conn->wftCount = 0;
+    conn->startPending = FALSE;
     conn->pduInfo.SduDataPtr = &(PduInfoPtr->SduDataPtr[headerSize]);
-    conn->pduInfo.MetaDataPtr = NULL;
+    conn->pduInfo.MetaDataPtr = conn->peerBound ? conn->metaData : NULL;
     conn->pduInfo.SduLength = PduInfoPtr->SduLength - headerSize;
 
     status = PduR_CanTpStartOfReception(conn->nsdu->id, &conn->pduInfo, conn->buffSize, &conn->aquiredBuffSize);
     switch (status) {
         case BUFREQ_OK:
-            if (conn->aquiredBuffSize < conn->buffSize) {
-                PduR_CanTpRxIndication(conn->nsdu->id, E_NOT_OK);
-                result = CANTP_RX_STATE_ABORT;
-            } 
-            else{
-                result = CANTP_RX_STATE_FC_TX_REQ;
-
-                if (conn->aquiredBuffSize < CanTp_GetRxBS(conn)) {
-                    conn->timer.br = 0;
-                    conn->fs = CANTP_FS_TYPE_WT;
-                } 
-                else{
-                    conn->fs = CANTP_FS_TYPE_CTS;
+            result = CanTp_RxAcceptFF(conn);
+            break;
+        case BUFREQ_BUSY:
+            // The FF payload is kept and the start is retried after an FC.WAIT, ffBuf holds one frame
+            if ((conn->ffBuf != NULL) && (conn->pduInfo.SduLength <= conn->layout.frameLen)){
+                for (PduLengthType byteItr = 0; byteItr < conn->pduInfo.SduLength; byteItr++){
+                    conn->ffBuf[byteItr] = conn->pduInfo.SduDataPtr[byteItr];
                 }
-            }
-
-            if ((CanTp_CopyRxData(conn) != BUFREQ_OK)){
-                PduR_CanTpRxIndication(conn->nsdu->id, E_NOT_OK);
-                result = CANTP_RX_STATE_ABORT;
+                conn->pduInfo.SduDataPtr = conn->ffBuf;
+                conn->startPending = TRUE;
+                conn->fs = CANTP_FS_TYPE_WT;
+                result = CANTP_RX_STATE_FC_TX_REQ;
             } 
             else{
+                result = CANTP_RX_STATE_ABORT;
             }
             break;
         case BUFREQ_OVFL:
-            result = CANTP_RX_STATE_FC_TX_REQ;
+            // The sender is told with FC.OVFLW, the reception is aborted once the FC is sent
             conn->fs = CANTP_FS_TYPE_OVF;
+            conn->blockSize = 0;
+            result = CANTP_RX_STATE_FC_TX_REQ;
+            break;
         case BUFREQ_E_NOT_OK:
-        case BUFREQ_BUSY:
             result = CANTP_RX_STATE_ABORT;
             break;
         default:
@@ -429,17 +1619,17 @@ static CanTp_RxConnectionState CanTp_RxIndFF(CanTp_RxConnection *conn, const Pdu
 
 static CanTp_RxConnectionState CanTp_RxIndCF(CanTp_RxConnection *conn, const PduInfoType *PduInfoPtr, uint8 nAeSize){
     uint8 headerSize;
-    uint8 payloadSize;
-    BufReq_ReturnType status;
+    PduLengthType remaining;
+    boolean lastInBlock;
     CanTp_RxConnectionState result = CANTP_RX_STATE_INVALID;
 
     // if reception is in progres report it and start new reception
-    if (conn->activation != CANTP_RX_PROCESSING){
+    if (CANTP_RX_ACTIVATION(conn) != CANTP_RX_PROCESSING){
         result = CANTP_RX_STATE_ABORT;
         return result;
     }
 
-    if (conn->state != CANTP_RX_STATE_WAIT_CF){
+    if (CANTP_RX_STATE(conn) != CANTP_RX_STATE_WAIT_CF){
         result = CANTP_RX_STATE_ABORT;
         return result;
     }
@@ -451,24 +1641,32 @@ static CanTp_RxConnectionState CanTp_RxIndCF(CanTp_RxConnection *conn, const Pdu
     }
 
     headerSize = CANTP_CF_PCI_SIZE + nAeSize;
+    // CF too short for its N_PCI is ignored
+    if (PduInfoPtr->SduLength < headerSize){
+        return CANTP_RX_STATE(conn);
+    }
 
     conn->sn++;
-    conn->bs--;
 
     conn->pduInfo.SduDataPtr = &(PduInfoPtr->SduDataPtr[headerSize]);
     conn->pduInfo.MetaDataPtr = NULL;
     conn->pduInfo.SduLength = PduInfoPtr->SduLength - headerSize;
+    // The last CF may be padded, only the remaining part of the message is copied
+    remaining = conn->buffSize - conn->reassembly.count;
+    if (conn->pduInfo.SduLength > remaining){
+        conn->pduInfo.SduLength = remaining;
+    }
+    lastInBlock = (conn->blockSize != 0) && (conn->bs == 1);
 
-    if (CanTp_CopyRxData(conn) == BUFREQ_OK){
+    if (CanTp_RxStoreCF(conn, lastInBlock || (conn->pduInfo.SduLength == remaining)) == BUFREQ_OK){
         if (conn->buffSize != 0){
-            if (conn->bs == 0){
-                conn->bs = conn->nsdu->bs;
-                conn->timer.br = 0;
-                result = CANTP_RX_STATE_WAIT_CF;
+            // BS = 0 means that the sender does not wait for further FCs
+            if ((conn->blockSize != 0) && (--conn->bs == 0)){
+                CanTp_RxPrepareFC(conn);
+                result = CANTP_RX_STATE_FC_TX_REQ;
             } 
             else{
-                conn->timer.cr = 0;
-                result = CANTP_RX_STATE_FC_TX_REQ;
+                result = CANTP_RX_STATE_WAIT_CF;
             }
         } 
         else{
@@ -483,71 +1681,392 @@ static CanTp_RxConnectionState CanTp_RxIndCF(CanTp_RxConnection *conn, const Pdu
     return result;
 }
 
-static CanTp_TxConnectionState CanTp_RxStateTXFC(CanTp_RxConnection *conn){
-    PduInfoType pduInfo;
-    PduLengthType remainingLength;
-    uint8 payloadOffset;
-    BufReq_ReturnType copyTxRet;
-    CanTp_RxConnectionState nextState;
+static CanTp_RxConnectionState CanTp_RxStateTXFC(CanTp_RxConnection *conn){
+    PduInfoType pduInfo;
+    uint8 *buf = &conn->fcBuf.data[conn->layout.nAe];
+    CanTp_RxConnectionState nextState;
+
+    if (conn->startPending){
+        switch (PduR_CanTpStartOfReception(conn->nsdu->id, &conn->pduInfo, conn->buffSize, &conn->aquiredBuffSize)){
+            case BUFREQ_OK:
+                conn->startPending = FALSE;
+                if (CanTp_RxAcceptFF(conn) == CANTP_RX_STATE_ABORT){
+                    return CANTP_RX_STATE_ABORT;
+                }
+                break;
+            case BUFREQ_BUSY:
+                break;
+            default:
+                return CANTP_RX_STATE_ABORT;
+        }
+    } 
+    else if (conn->fs == CANTP_FS_TYPE_WT){
+        // Ask PduR how much buffer became available since the FC was prepared
+        PduInfoType query = {.SduDataPtr = NULL, .MetaDataPtr = NULL, .SduLength = 0};
+        if (PduR_CanTpCopyRxData(conn->nsdu->id, &query, &conn->aquiredBuffSize) == BUFREQ_OK){
+            CanTp_RxPrepareFC(conn);
+        }
+    }
+
+    if (conn->fs == CANTP_FS_TYPE_WT){
+        // N_WFTmax reached, the sender would wait forever
+        if (conn->wftCount >= conn->nsdu->wftMax){
+            Det_ReportRuntimeError(CANTP_MODULE_ID, 0, CANTP_MAIN_FUNCTION_API_ID, CANTP_E_RX_COM);
+            if (!conn->startPending){
+                PduR_CanTpRxIndication(conn->nsdu->id, E_NOT_OK);
+            }
+            return CANTP_RX_STATE_ABORT;
+        }
+        conn->wftCount++;
+    } 
+    else{
+        conn->wftCount = 0;
+    }
+
+    if (conn->layout.nAe != 0){
+        conn->fcBuf.data[0] = conn->layout.txAddr;
+    }
+    buf[0] = (((uint8)CANTP_N_PCI_TYPE_FC) << 4) | (uint8)conn->fs;
+    buf[1] = conn->blockSize;
+    buf[2] = (uint8)CanTp_RxParams(conn)->stMin;
+
+    pduInfo.MetaDataPtr = conn->peerBound ? conn->fcMetaData : NULL;
+    pduInfo.SduDataPtr = conn->fcBuf.data;
+    pduInfo.SduLength = CanTp_PadFrame(conn->fcBuf.data, conn->layout.fcLen, conn->layout.padLen);
+
+    // Set before the request, CanIf may confirm the FC before CanIf_Transmit returns
+    CanTp_RxSetFcPending(conn, TRUE);
+    conn->fcSeq = CanTp_State.frameSeq++;
+    CanTp_TimerStart(CanTp_RxTimerIdx(conn), CANTP_TIMER_N_AR, conn->nsdu->nar);
+    if (CanIf_Transmit(CanTp_RxFcPduId(conn->nsdu), &pduInfo) != E_OK){
+        CanTp_RxSetFcPending(conn, FALSE);
+        // Only a reception PduR accepted is indicated
+        if (!conn->startPending && (conn->fs != CANTP_FS_TYPE_OVF)){
+            PduR_CanTpRxIndication(conn->nsdu->id, E_NOT_OK);
+        }
+        nextState = CANTP_RX_STATE_ABORT;
+    } 
+    else if (conn->fs == CANTP_FS_TYPE_OVF){
+        // PduR did not accept the reception, it is not indicated
+        CanTp_RxSetFcPending(conn, FALSE);
+        nextState = CANTP_RX_STATE_ABORT;
+    } 
+    else if (conn->fs == CANTP_FS_TYPE_WT){
+        // The sender waits for another FC, sent after N_Br or on the next period without N_Br
+        nextState = (conn->nsdu->nbr != 0) ? CANTP_RX_STATE_WAIT_BUFFER : CANTP_RX_STATE_FC_TX_REQ;
+    } 
+    else{
+        nextState = CANTP_RX_STATE_WAIT_CF;
+    }
+    return nextState;
+}
+
+/**
+  @brief Processes the CanIf confirmation of an FC
+
+  N_Ar stops and the timeout of the state the reception is in starts. An FC CanIf failed to send aborts the reception.
+*/
+static void CanTp_RxFcConfirmation(CanTp_RxConnection *conn, Std_ReturnType result){
+    CanTp_RxSetFcPending(conn, FALSE);
+    if (result == E_OK){
+        if (conn->nsdu->nar != 0){
+            CanTp_RxArmTimer(conn, CANTP_RX_STATE(conn));
+        }
+    } 
+    else if ((CANTP_RX_STATE(conn) == CANTP_RX_STATE_WAIT_CF) || (CANTP_RX_STATE(conn) == CANTP_RX_STATE_FC_TX_REQ) ||
+             (CANTP_RX_STATE(conn) == CANTP_RX_STATE_WAIT_BUFFER)){
+        if (!conn->startPending){
+            PduR_CanTpRxIndication(conn->nsdu->id, E_NOT_OK);
+        }
+        CanTp_RxSetState(conn, CANTP_RX_STATE_ABORT);
+    }
+}
+
+/**
+  @brief Processes an FC received while waiting for it
+
+  CTS starts the next block, WAIT keeps waiting with N_Bs restarted by the caller, OVFLW and an invalid FS
+  abort the transmission.
+*/
+static CanTp_TxConnectionState CanTp_RxIndFC(CanTp_TxConnection *conn, const PduInfoType *PduInfoPtr, uint8 nAeSize){
+    const uint8 *fc = &PduInfoPtr->SduDataPtr[nAeSize];
+    CanTp_TxConnectionState nextState;
+
+    if (PduInfoPtr->SduLength < conn->layout.fcLen){
+        return CANTP_TX_STATE(conn);
+    }
+
+    switch ((CanTp_FsType)(fc[0] & 0x0F)){
+        case CANTP_FS_TYPE_CTS:
+            conn->bs = fc[1];
+            conn->stMin = fc[2];
+            conn->blockRemaining = conn->bs;
+            // The receiver has everything sent so far, PduR may release it
+            conn->retry.TpDataStateType = TP_DATA_CONF;
+            // The first CF of a block is not delayed by STmin
+            conn->nextCfTime = CanTp_State.currentTime;
+            nextState = CANTP_TX_STATE_CF_SEND_REQ;
+            break;
+        case CANTP_FS_TYPE_WT:
+            nextState = CANTP_TX_STATE_WAIT_FC;
+            break;
+        case CANTP_FS_TYPE_OVF:
+        default:
+            Det_ReportRuntimeError(CANTP_MODULE_ID, 0, CANTP_RX_INDICATION_API_ID, CANTP_E_TX_COM);
+            PduR_CanTpTxConfirmation(conn->nsdu->id, E_NOT_OK);
+            CANTP_TX_ACTIVATION(conn) = CANTP_TX_WAIT;
+            nextState = CANTP_TX_STATE_FREE;
+            break;
+    }
+    return nextState;
+}
+
+static inline void CanTp_FillTpHeader(CanTp_TxConnection *conn, CanTp_PciType pciType){
+    uint8 addressingInfoOffset = conn->layout.nAe;
+    uint8 *buf = &conn->buf.data[addressingInfoOffset];
+    PduLengthType length = conn->pduInfo.SduLength;
+
+    if (addressingInfoOffset != 0){
+        conn->buf.data[0] = conn->layout.txAddr;
+    }
+    buf[0] = ((uint8)pciType << 4);
+
+    switch (pciType){
+        case CANTP_N_PCI_TYPE_SF:
+            if ((CANTP_SF_PCI_SIZE + addressingInfoOffset + length) <= CAN_2_0_MAX_LEN){
+                buf[0] |= (uint8)(length & 0x0F);
+                conn->buf.payloadOffset = CANTP_SF_PCI_SIZE + addressingInfoOffset;
+            } 
+            else{
+                // SF_DL escape sequence, low nibble stays 0
+                buf[1] = (uint8)length;
+                conn->buf.payloadOffset = CANTP_SF_ESC_PCI_SIZE + addressingInfoOffset;
+            }
+            break;
+
+        case CANTP_N_PCI_TYPE_FF:
+            if (length <= CANTP_FF_DL_12BIT_MAX){
+                buf[0] |= (uint8)((length >> 8) & 0x0F);
+                buf[1] = (uint8)length;
+                conn->buf.payloadOffset = CANTP_FF_PCI_SIZE + addressingInfoOffset;
+            } 
+            else{
+                // FF_DL escape sequence, 12 bit FF_DL is 0 and the 32 bit length follows
+                buf[1] = 0;
+                buf[2] = (uint8)((uint32)length >> 24);
+                buf[3] = (uint8)((uint32)length >> 16);
+                buf[4] = (uint8)((uint32)length >> 8);
+                buf[5] = (uint8)length;
+                conn->buf.payloadOffset = CANTP_FF_ESC_PCI_SIZE + addressingInfoOffset;
+            }
+            break;
+
+        case CANTP_N_PCI_TYPE_CF:
+            buf[0] |= (uint8)(conn->sequenceNumber & 0x0F);
+            conn->buf.payloadOffset = CANTP_CF_PCI_SIZE + addressingInfoOffset;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+  @brief Copies tx data from PduR
+
+  The retry state applies to a single successful call, afterwards the copied data is pending again.
+*/
+static BufReq_ReturnType CanTp_TxCopyTxData(CanTp_TxConnection *conn, const PduInfoType *pduInfo, PduLengthType *availableData){
+    BufReq_ReturnType result = PduR_CanTpCopyTxData(conn->nsdu->id, pduInfo, &conn->retry, availableData);
+
+    if (result == BUFREQ_OK){
+        conn->retry.TpDataStateType = TP_CONFPENDING;
+        conn->retry.TxTpDataCnt = 0;
+        conn->availableData = *availableData;
+    }
+    return result;
+}
+
+#if CONFIG_CANTP_TX_RETRY_MAX > 0
+/**
+  @brief Rewinds the segmentation to the N-PDU CanIf failed to send
 
-    conn->fcBuf.data[0] = (((uint8)CANTP_N_PCI_TYPE_FC) << 4) || conn->fs;
-    conn->fcBuf.data[0] = conn->bs;
-    conn->fcBuf.data[0] = conn->nsdu->STmin;
+  The payload is taken again from where it came from: the retained SDU of zero-copy transfers, the staging
+  buffer, or PduR asked for TP_DATARETRY of the payload length. Returns the state sending the frame again.
+*/
+static CanTp_TxConnectionState CanTp_TxRewindFrame(CanTp_TxConnection *conn){
+    PduLengthType payloadLength = conn->buf.payloadLength - conn->buf.payloadOffset;
+    CanTp_TxConnectionState nextState;
 
-    pduInfo.MetaDataPtr = NULL;
-    pduInfo.SduDataPtr = &conn->fcBuf.data[CanTp_GetAddrFieldLen(conn->nsdu->addressingFormat)];
-    pduInfo.SduLength = 3;
+    switch (conn->lastFrameType){
+        case CANTP_N_PCI_TYPE_FF:
+            conn->pduInfo.SduLength += payloadLength;
+            nextState = CANTP_TX_STATE_FF_SEND_REQ;
+            break;
+        case CANTP_N_PCI_TYPE_CF:
+            conn->pduInfo.SduLength += payloadLength;
+            conn->sequenceNumber -= CANTP_SEQUENCE_NUMBER_INCREMENT_VALUE;
+            nextState = CANTP_TX_STATE_CF_SEND_REQ;
+            break;
+        case CANTP_N_PCI_TYPE_SF:
+        default:
+            nextState = CANTP_TX_STATE_SF_SEND_REQ;
+            break;
+    }
 
-    if (CanIf_Transmit(conn->nsdu->id, &pduInfo) == E_OK){
-        nextState = CANTP_RX_STATE_WAIT_CF;
+#if defined(CONFIG_CANTP_ZERO_COPY_TX)
+    if (conn->sduData != NULL){
+        conn->sduOffset -= payloadLength;
+        return nextState;
+    }
+#endif
+    if ((conn->staging.data != NULL) && (conn->lastFrameType == CANTP_N_PCI_TYPE_CF) && (conn->staging.size >= payloadLength)){
+        // The payload is still in front of the staged data
+        conn->staging.offset -= (uint16)payloadLength;
+        conn->staging.count += (uint16)payloadLength;
     } 
     else{
-        nextState = CANTP_RX_STATE_ABORT;
+        conn->retry.TpDataStateType = TP_DATARETRY;
+        conn->retry.TxTpDataCnt = payloadLength;
     }
     return nextState;
 }
+#endif
+
+/**
+  @brief Number of bytes fetched into the staging buffer at once
+
+  One block of CFs when the receiver set BS, otherwise the whole buffer.
+*/
+static inline uint16 CanTp_TxStagingWindow(const CanTp_TxConnection *conn){
+    uint32 window = conn->staging.size;
+    uint32 blockLen = (uint32)conn->bs * conn->layout.cfPayload;
 
-static CanTp_RxConnectionState CanTp_RxIndFC(CanTp_TxConnection *conn, const PduInfoType *PduInfoPtr, uint8 nAeSize){
-    conn->state = CANTP_TX_STATE_CF_SEND_REQ;
+    if ((blockLen != 0) && (blockLen < window)){
+        window = blockLen;
+    }
+    return (uint16)window;
 }
 
-static inline void CanTp_FillTpHeader(CanTp_TxConnection *conn, CanTp_PciType pciType){
-    uint8 addressingInfoOffset = CanTp_GetAddrFieldLen(conn->nsdu->addressingFormat);
-    uint8 *buf = &conn->buf.data[addressingInfoOffset];
+/**
+  @brief Cuts the CF payload from the staging buffer
 
-    buf[0] = ((uint8)pciType << 4);
+  When the staged data is shorter than the CF, the rest (less than one CF) is moved to the front
+  and the buffer is refilled by a single PduR_CanTpCopyTxData call.
+  conn->pduInfo.SduLength holds the number of bytes not sent yet, staged ones included.
+*/
+static BufReq_ReturnType CanTp_TxStagingFetch(CanTp_TxConnection *conn, const PduInfoType *pduInfo, PduLengthType *remainingLength){
+    CanTp_TxStaging *staging = &conn->staging;
+    BufReq_ReturnType result = BUFREQ_OK;
+    PduLengthType availableData;
+
+    if (staging->count < pduInfo->SduLength){
+        for (uint16 byteItr = 0; byteItr < staging->count; byteItr++){
+            staging->data[byteItr] = staging->data[staging->offset + byteItr];
+        }
+        staging->offset = 0;
+
+        PduInfoType fill = {.MetaDataPtr = NULL, .SduDataPtr = &staging->data[staging->count]};
+        fill.SduLength = CanTp_TxStagingWindow(conn);
+        fill.SduLength = (fill.SduLength > staging->count) ? (fill.SduLength - staging->count) : 0;
+        // A streamed SDU is prefetched only as far as PduR has it, at least one CF is always requested
+        if (fill.SduLength > conn->availableData){
+            fill.SduLength = conn->availableData;
+        }
+        if (fill.SduLength < (pduInfo->SduLength - staging->count)){
+            fill.SduLength = pduInfo->SduLength - staging->count;
+        }
+        if (fill.SduLength > (conn->pduInfo.SduLength - staging->count)){
+            fill.SduLength = conn->pduInfo.SduLength - staging->count;
+        }
 
-    switch (pciType){
-        case CANTP_N_PCI_TYPE_SF:
-#if defined(CONFIG_CAN_2_0_OR_CAN_FD)
-            buf[0] &= (uint8)0xF0;
-            buf[0] |= (uint8)(conn->pduInfo.SduLength & 0x0F);
-            conn->buf.payloadOffset = CANTP_SF_PCI_SIZE + addressingInfoOffset;
-#elif defined(CONFIG_CAN_FD_ONLY)
-#error "Implement CanTp_FillTpHeader for CAN_FD"
-#endif
-            break;
+        result = CanTp_TxCopyTxData(conn, &fill, &availableData);
+        if (result == BUFREQ_OK){
+            staging->count += (uint16)fill.SduLength;
+        }
+    }
 
-        case CANTP_N_PCI_TYPE_FF:
-#if defined(CONFIG_CAN_2_0_OR_CAN_FD)
-            *((uint16 *)&buf[0]) = (CANTP_N_PCI_TYPE_FF << 12) | (conn->pduInfo.SduLength & 0x0FFF);
-            conn->buf.payloadOffset = CANTP_FF_PCI_SIZE + addressingInfoOffset;
-#elif defined(CONFIG_CAN_FD_ONLY)
-#error "Implement CanTp_FillTpHeader for CAN_FD"
+    if (result == BUFREQ_OK){
+        for (PduLengthType byteItr = 0; byteItr < pduInfo->SduLength; byteItr++){
+            pduInfo->SduDataPtr[byteItr] = staging->data[staging->offset + byteItr];
+        }
+        staging->offset += (uint16)pduInfo->SduLength;
+        staging->count -= (uint16)pduInfo->SduLength;
+        *remainingLength = conn->pduInfo.SduLength - pduInfo->SduLength;
+    }
+    return result;
+}
+
+/**
+  @brief Fetches the payload of the next N-PDU
+
+  The data is copied by PduR into conn->buf, for zero-copy transfers the payload only refers to the retained SDU.
+  remainingLength receives the bytes of the SDU left after this N-PDU. It is counted by CanTp and not taken
+  from PduR, which may stream the SDU and report less data than is left.
+*/
+static BufReq_ReturnType CanTp_TxFetchPayload(CanTp_TxConnection *conn, const PduInfoType *pduInfo, PduLengthType *remainingLength){
+    BufReq_ReturnType result;
+    PduLengthType availableData;
+
+#if defined(CONFIG_CANTP_ZERO_COPY_TX)
+    if (conn->sduData != NULL){
+        conn->payloadData = &conn->sduData[conn->sduOffset];
+        conn->sduOffset += pduInfo->SduLength;
+        *remainingLength = conn->sduLength - conn->sduOffset;
+        return BUFREQ_OK;
+    }
 #endif
-            break;
+    if ((conn->staging.data != NULL) && (CANTP_TX_STATE(conn) == CANTP_TX_STATE_CF_SEND_REQ) && (conn->staging.size >= pduInfo->SduLength)){
+        return CanTp_TxStagingFetch(conn, pduInfo, remainingLength);
+    }
+    result = CanTp_TxCopyTxData(conn, pduInfo, &availableData);
+    *remainingLength = conn->pduInfo.SduLength - pduInfo->SduLength;
+    return result;
+}
 
-        case CANTP_N_PCI_TYPE_CF:
-#if defined(CONFIG_CAN_2_0_OR_CAN_FD)
-            buf[0] &= (uint8)0xF0;
-            buf[0] |= (uint8)(conn->sequenceNumber & 0x0F);
-            conn->buf.payloadOffset = CANTP_CF_PCI_SIZE + addressingInfoOffset;
-#elif defined(CONFIG_CAN_FD_ONLY)
-#error "Implement CanTp_FillTpHeader for CAN_FD"
+/**
+  @brief Hands the N-PDU prepared in conn->buf over to CanIf
+
+  Zero-copy transfers pass the header and the payload separately, CanIf gathers the frame from both.
+*/
+static Std_ReturnType CanTp_TxTransmitFrame(CanTp_TxConnection *conn){
+    uint8 *metaData = conn->layout.canIdAddr ? conn->metaData : NULL;
+#if defined(CONFIG_CANTP_ZERO_COPY_TX)
+    if (conn->sduData != NULL){
+        PduLengthType payloadLength = conn->buf.payloadLength - conn->buf.payloadOffset;
+        if ((CanTp_DlcLength[conn->buf.payloadLength] == conn->buf.payloadLength) && (conn->buf.payloadLength >= conn->layout.padLen)){
+            const PduInfoType header = {.MetaDataPtr = metaData, .SduDataPtr = conn->buf.data, .SduLength = conn->buf.payloadOffset};
+            const PduInfoType payload = {.MetaDataPtr = NULL, .SduDataPtr = conn->payloadData, .SduLength = payloadLength};
+            return CanIf_TransmitGather(conn->nsdu->id, &header, &payload);
+        }
+        // A frame to be padded (only the last one) is copied, the padding has to follow the payload
+        for (PduLengthType byteItr = 0; byteItr < payloadLength; byteItr++){
+            conn->buf.data[conn->buf.payloadOffset + byteItr] = conn->payloadData[byteItr];
+        }
+    }
 #endif
-        default:
-            break;
+    const PduInfoType pduInfo = {.MetaDataPtr = metaData, .SduDataPtr = conn->buf.data,
+                                 .SduLength = CanTp_PadFrame(conn->buf.data, conn->buf.payloadLength, conn->layout.padLen)};
+    return CanIf_Transmit(conn->nsdu->id, &pduInfo);
+}
+
+/**
+  @brief Passes the prepared N-PDU to CanIf and waits for its confirmation
+
+  The state is switched before the request, because CanIf may confirm the frame before CanIf_Transmit returns.
+  The N_As timer started for the SEND_PROCESS state keeps running until the confirmation.
+*/
+static CanTp_TxConnectionState CanTp_TxTransmitAndWait(CanTp_TxConnection *conn, CanTp_PciType frameType){
+    CanTp_TxConnectionState processState = CANTP_TX_STATE(conn);
+
+    conn->lastFrameType = frameType;
+    conn->confirmSeq = CanTp_State.frameSeq++;
+    CANTP_TX_STATE(conn) = CANTP_TX_STATE_WAIT_CANIF_CONFIRM;
+    if (CanTp_TxTransmitFrame(conn) != E_OK){
+        // Retry in the next period
+        CANTP_TX_STATE(conn) = processState;
     }
+    return CANTP_TX_STATE(conn);
 }
 
 static CanTp_TxConnectionState CanTp_TxStateSFSendReq(CanTp_TxConnection *conn){
@@ -563,7 +2082,7 @@ static CanTp_TxConnectionState CanTp_TxStateSFSendReq(CanTp_TxConnection *conn){
     pduInfo.SduLength = conn->pduInfo.SduLength;
 
     // Lock the data within PduR
-    copyTxRet = PduR_CanTpCopyTxData(conn->nsdu->id, &pduInfo, NULL, &remainingLength);
+    copyTxRet = CanTp_TxFetchPayload(conn, &pduInfo, &remainingLength);
 
     if (copyTxRet == BUFREQ_OK){
         conn->buf.payloadLength = conn->pduInfo.SduLength + conn->buf.payloadOffset;
@@ -576,21 +2095,7 @@ static CanTp_TxConnectionState CanTp_TxStateSFSendReq(CanTp_TxConnection *conn){
 }
 
 static CanTp_TxConnectionState CanTp_TxStateSFProcess(CanTp_TxConnection *conn){
-    CanTp_TxConnectionState nextState;
-    Std_ReturnType transmitResult;
-    const PduInfoType pduInfo = {.MetaDataPtr = NULL, .SduDataPtr = conn->buf.data, .SduLength = conn->buf.payloadLength};
-
-    transmitResult = CanIf_Transmit(conn->nsdu->id, &pduInfo);
-    if (transmitResult == E_OK){
-        // Inform higher layer about successful transmission
-        PduR_CanTpTxConfirmation(conn->nsdu->id, E_OK);
-        nextState = CANTP_TX_STATE_FREE;
-        conn->activation = CANTP_TX_WAIT;
-    } 
-    else{
-        nextState = CANTP_TX_STATE_SF_SEND_PROCESS;
-    }
-    return nextState;
+    return CanTp_TxTransmitAndWait(conn, CANTP_N_PCI_TYPE_SF);
 }
 
 static CanTp_TxConnectionState CanTp_TxStateFFSendReq(CanTp_TxConnection *conn){
@@ -603,9 +2108,9 @@ static CanTp_TxConnectionState CanTp_TxStateFFSendReq(CanTp_TxConnection *conn){
 
     pduInfo.MetaDataPtr = NULL;
     pduInfo.SduDataPtr = &conn->buf.data[conn->buf.payloadOffset];
-    pduInfo.SduLength = CAN_2_0_MAX_LEN - conn->buf.payloadOffset;
+    pduInfo.SduLength = conn->layout.frameLen - conn->buf.payloadOffset;
 
-    copyTxRet = PduR_CanTpCopyTxData(conn->nsdu->id, &pduInfo, NULL, &remainingLength);
+    copyTxRet = CanTp_TxFetchPayload(conn, &pduInfo, &remainingLength);
 
     if (copyTxRet == BUFREQ_OK){
         conn->buf.payloadLength = pduInfo.SduLength + conn->buf.payloadOffset;
@@ -619,25 +2124,13 @@ static CanTp_TxConnectionState CanTp_TxStateFFSendReq(CanTp_TxConnection *conn){
 }
 
 static CanTp_TxConnectionState CanTp_TxStateFFSendProcess(CanTp_TxConnection *conn){
-    CanTp_TxConnectionState nextState;
-    Std_ReturnType transmitResult;
-    const PduInfoType pduInfo = {.MetaDataPtr = NULL, .SduDataPtr = conn->buf.data, .SduLength = conn->buf.payloadLength};
-
-    transmitResult = CanIf_Transmit(conn->nsdu->id, &pduInfo);
-    if (transmitResult == E_OK){
-        // Start waiting for FC
-        nextState = CANTP_TX_STATE_WAIT_FC;
-        conn->sequenceNumber = CANTP_SEQUENCE_NUMBER_START_VALUE;
-    } 
-    else{
-        nextState = CANTP_TX_STATE_FF_SEND_PROCESS;
-    }
-    return nextState;
+    conn->sequenceNumber = CANTP_SEQUENCE_NUMBER_START_VALUE;
+    return CanTp_TxTransmitAndWait(conn, CANTP_N_PCI_TYPE_FF);
 }
 
 static CanTp_TxConnectionState CanTp_TxStateFFWaitFC(CanTp_TxConnection *conn){
     // Do nothing
-    return conn->state;
+    return CANTP_TX_STATE(conn);
 }
 
 static CanTp_TxConnectionState CanTp_TxStateCFSendReq(CanTp_TxConnection *conn){
@@ -648,7 +2141,7 @@ static CanTp_TxConnectionState CanTp_TxStateCFSendReq(CanTp_TxConnection *conn){
     uint8 maxCFSize;
 
     CanTp_FillTpHeader(conn, CANTP_N_PCI_TYPE_CF);
-    maxCFSize = CAN_2_0_MAX_LEN - conn->buf.payloadOffset;
+    maxCFSize = conn->layout.cfPayload;
 
     pduInfo.MetaDataPtr = NULL;
     pduInfo.SduDataPtr = &conn->buf.data[conn->buf.payloadOffset];
@@ -661,7 +2154,7 @@ static CanTp_TxConnectionState CanTp_TxStateCFSendReq(CanTp_TxConnection *conn){
     }
 
     // Lock the data within PduR
-    copyTxRet = PduR_CanTpCopyTxData(conn->nsdu->id, &pduInfo, NULL, &remainingLength);
+    copyTxRet = CanTp_TxFetchPayload(conn, &pduInfo, &remainingLength);
 
     if (copyTxRet == BUFREQ_OK){
         conn->buf.payloadLength = pduInfo.SduLength + conn->buf.payloadOffset;
@@ -676,24 +2169,42 @@ static CanTp_TxConnectionState CanTp_TxStateCFSendReq(CanTp_TxConnection *conn){
 }
 
 static CanTp_TxConnectionState CanTp_TxStateCFSendProcess(CanTp_TxConnection *conn){
+    return CanTp_TxTransmitAndWait(conn, CANTP_N_PCI_TYPE_CF);
+}
+
+/**
+  @brief Next state after CanIf confirmed the N-PDU sent by the connection
+*/
+static CanTp_TxConnectionState CanTp_TxStateConfirmed(CanTp_TxConnection *conn){
     CanTp_TxConnectionState nextState;
-    Std_ReturnType transmitResult;
-    const PduInfoType pduInfo = {.MetaDataPtr = NULL, .SduDataPtr = conn->buf.data, .SduLength = conn->buf.payloadLength};
 
-    transmitResult = CanIf_Transmit(conn->nsdu->id, &pduInfo);
-    if (transmitResult == E_OK){
-        // Determine if further fragmentation is needed
-        if (conn->pduInfo.SduLength > 0){
-            nextState = CANTP_TX_STATE_CF_SEND_REQ;
-        } 
-        else{
-            // No fragmentation needed, inform higher layer and free nsdu
+    switch (conn->lastFrameType){
+        case CANTP_N_PCI_TYPE_FF:
+            // Start waiting for FC
+            nextState = CANTP_TX_STATE_WAIT_FC;
+            break;
+        case CANTP_N_PCI_TYPE_CF:
+            // STmin is measured from the end of the CF transmission
+            conn->nextCfTime = CanTp_State.currentTime + (CanTp_StMinToPeriods(conn->stMin) * CONFIG_CANTP_MAIN_FUNCTION_PERIOD);
+            // Determine if further fragmentation is needed
+            if (conn->pduInfo.SduLength > 0){
+                // The last CF of a block waits for the next FC
+                if ((conn->bs != 0) && (--conn->blockRemaining == 0)){
+                    nextState = CANTP_TX_STATE_WAIT_FC;
+                } 
+                else{
+                    nextState = CANTP_TX_STATE_CF_SEND_REQ;
+                }
+                break;
+            }
+            // fall through
+        case CANTP_N_PCI_TYPE_SF:
+        default:
+            // Whole message sent, inform higher layer and free nsdu
             PduR_CanTpTxConfirmation(conn->nsdu->id, E_OK);
             nextState = CANTP_TX_STATE_FREE;
-            conn->activation = CANTP_TX_WAIT;
-        }
-    } else{
-        nextState = CANTP_TX_STATE_CF_SEND_PROCESS;
+            CANTP_TX_ACTIVATION(conn) = CANTP_TX_WAIT;
+            break;
     }
     return nextState;
 }
@@ -701,87 +2212,197 @@ static CanTp_TxConnectionState CanTp_TxStateCFSendProcess(CanTp_TxConnection *co
 static CanTp_TxConnectionState CanTp_TxStateCancel(CanTp_TxConnection *conn){
     CanTp_TxConnectionState nextState = CANTP_TX_STATE_FREE;
     PduR_CanTpTxConfirmation(conn->nsdu->id, E_NOT_OK);
-    conn->activation = CANTP_TX_WAIT;
+    CANTP_TX_ACTIVATION(conn) = CANTP_TX_WAIT;
     return nextState;
 }
 
-static void CanTp_TxIteration(void){
-    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.txConnections); connItr++){
-        CanTp_TxConnection *conn = &CanTp_State.txConnections[connItr];
-        CanTp_TxConnectionState nextState = conn->state;
+static inline boolean CanTp_TxPacingAllows(const CanTp_TxConnection *conn){
+    return (conn->stMin == 0) || ((sint32)(CanTp_State.currentTime - conn->nextCfTime) >= 0);
+}
 
-        // TX state machine
-        switch (conn->state) {
-            case CANTP_TX_STATE_SF_SEND_REQ:
-                nextState = CanTp_TxStateSFSendReq(conn);
-                break;
-            case CANTP_TX_STATE_SF_SEND_PROCESS:
-                nextState = CanTp_TxStateSFProcess(conn);
-                break;
-            case CANTP_TX_STATE_FF_SEND_REQ:
-                nextState = CanTp_TxStateFFSendReq(conn);
-                break;
-            case CANTP_TX_STATE_FF_SEND_PROCESS:
-                nextState = CanTp_TxStateFFSendProcess(conn);
-                break;
-            case CANTP_TX_STATE_WAIT_FC:
-                nextState = CanTp_TxStateFFWaitFC(conn);
-                break;
-            case CANTP_TX_STATE_CF_SEND_REQ:
-                nextState = CanTp_TxStateCFSendReq(conn);
-                break;
-            case CANTP_TX_STATE_CF_SEND_PROCESS:
-                nextState = CanTp_TxStateCFSendProcess(conn);
-                break;
-            case CANTP_TX_STATE_FREE:
-                break;
-            case CANTP_TX_STATE_CANCEL:
-                nextState = CanTp_TxStateCancel(conn);
-                break;
-            default:
-                break;
+static inline uint32 CanTp_TxCfBudget(const CanTp_TxConnection *conn){
+    return ((conn->channel != NULL) && (conn->channel->maxCfPerTick != 0)) ? conn->channel->maxCfPerTick : 1U;
+}
+
+/**
+  @brief Immediate dispatch
+
+  On channels with immediateDispatch the next CF is sent from the event (FC reception or CanIf confirmation)
+  instead of waiting for the next CanTp_MainFunction period.
+  CFs confirmed from within CanIf_Transmit are followed by the next one in a loop, not by recursion.
+*/
+static void CanTp_TxDispatchCF(CanTp_TxConnection *conn){
+    if ((conn->channel == NULL) || !conn->channel->immediateDispatch || conn->dispatching){
+        return;
+    }
+    conn->dispatching = TRUE;
+    do{
+        if ((CANTP_TX_STATE(conn) == CANTP_TX_STATE_CF_SEND_REQ) && CanTp_TxPacingAllows(conn)){
+            CanTp_TxSetState(conn, CanTp_TxStateCFSendReq(conn));
+        }
+        if (CANTP_TX_STATE(conn) != CANTP_TX_STATE_CF_SEND_PROCESS){
+            break;
+        }
+        CanTp_TxSetState(conn, CanTp_TxStateCFSendProcess(conn));
+    } while (CANTP_TX_STATE(conn) == CANTP_TX_STATE_CF_SEND_REQ);
+    conn->dispatching = FALSE;
+}
+
+static CanTp_TxConnectionState CanTp_TxStep(CanTp_TxConnection *conn){
+    CanTp_TxConnectionState nextState = CANTP_TX_STATE(conn);
+
+    // TX state machine
+    switch (CANTP_TX_STATE(conn)) {
+        case CANTP_TX_STATE_SF_SEND_REQ:
+            nextState = CanTp_TxStateSFSendReq(conn);
+            break;
+        case CANTP_TX_STATE_SF_SEND_PROCESS:
+            nextState = CanTp_TxStateSFProcess(conn);
+            break;
+        case CANTP_TX_STATE_FF_SEND_REQ:
+            nextState = CanTp_TxStateFFSendReq(conn);
+            break;
+        case CANTP_TX_STATE_FF_SEND_PROCESS:
+            nextState = CanTp_TxStateFFSendProcess(conn);
+            break;
+        case CANTP_TX_STATE_WAIT_FC:
+            nextState = CanTp_TxStateFFWaitFC(conn);
+            break;
+        case CANTP_TX_STATE_CF_SEND_REQ:
+            nextState = CanTp_TxStateCFSendReq(conn);
+            break;
+        case CANTP_TX_STATE_CF_SEND_PROCESS:
+            nextState = CanTp_TxStateCFSendProcess(conn);
+            break;
+        case CANTP_TX_STATE_FREE:
+            break;
+        case CANTP_TX_STATE_CANCEL:
+            nextState = CanTp_TxStateCancel(conn);
+            break;
+        default:
+            break;
+    }
+    return nextState;
+}
+
+static inline boolean CanTp_TxIsSendingCF(const CanTp_TxConnection *conn){
+    return (CANTP_TX_STATE(conn) == CANTP_TX_STATE_CF_SEND_REQ) || (CANTP_TX_STATE(conn) == CANTP_TX_STATE_CF_SEND_PROCESS);
+}
+
+static void CanTp_TxIteration(void){
+    // Walk backwards: a connection freed by its handler is replaced by the last (already visited) active one
+    for (uint32 activeItr = CanTp_State.txActiveCount; activeItr > 0; activeItr--){
+        uint16 connIdx = CanTp_State.txActive[activeItr - 1];
+        CanTp_TxConnection *conn;
+        CanTp_TxConnectionState prevState;
+        uint32 cfBudget;
+
+        // Waiting connections are advanced by CanTp_RxIndication, CanTp_TxConfirmation or their timer,
+        // they are skipped from the state alone
+        if ((CANTP_TX_STATE_AT(connIdx) == CANTP_TX_STATE_WAIT_FC) || (CANTP_TX_STATE_AT(connIdx) == CANTP_TX_STATE_WAIT_CANIF_CONFIRM)){
+            continue;
         }
-        conn->state = nextState;
+        conn = &CanTp_State.txConnections[connIdx];
+        cfBudget = CanTp_TxIsSendingCF(conn) ? CanTp_TxCfBudget(conn) : 1U;
+
+        // Consecutive frames are sent back to back until the channel budget or STmin stops them.
+        // A CF CanIf has not confirmed within CanIf_Transmit ends the burst (WAIT_CANIF_CONFIRM)
+        conn->dispatching = TRUE;
+        do{
+            if ((CANTP_TX_STATE(conn) == CANTP_TX_STATE_CF_SEND_REQ) && ((cfBudget == 0) || !CanTp_TxPacingAllows(conn))){
+                break;
+            }
+            prevState = CANTP_TX_STATE(conn);
+            CanTp_TxSetState(conn, CanTp_TxStep(conn));
+
+            if ((prevState == CANTP_TX_STATE_CF_SEND_PROCESS) && (CANTP_TX_STATE(conn) != CANTP_TX_STATE_CF_SEND_PROCESS)){
+                cfBudget--;
+            }
+        } while ((CANTP_TX_STATE(conn) != prevState) && CanTp_TxIsSendingCF(conn));
+        conn->dispatching = FALSE;
     }
 }
 
 static void CanTp_RxIteration(void){
     CanTp_RxConnectionState nextState;
-    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxConnections); connItr++){
-        CanTp_RxConnection *conn = &CanTp_State.rxConnections[connItr];
-        nextState = conn->state;
+    for (uint32 activeItr = CanTp_State.rxActiveCount; activeItr > 0; activeItr--){
+        uint16 connIdx = CanTp_State.rxActive[activeItr - 1];
+        CanTp_RxConnection *conn;
+
+        if ((CANTP_RX_STATE_AT(connIdx) == CANTP_RX_STATE_WAIT_CF) || (CANTP_RX_STATE_AT(connIdx) == CANTP_RX_STATE_WAIT_BUFFER)){
+            continue;
+        }
+        conn = &CanTp_State.rxConnections[connIdx];
+        nextState = CANTP_RX_STATE(conn);
         // RX state machine
-        switch (conn->state) {
+        switch (CANTP_RX_STATE(conn)) {
             case CANTP_RX_STATE_FREE:
                 break;
             case CANTP_RX_STATE_WAIT_CF:
+            case CANTP_RX_STATE_WAIT_BUFFER:
                 break;
             case CANTP_RX_STATE_FC_TX_REQ:
-                CanTp_RxStateTXFC(conn);
+                nextState = CanTp_RxStateTXFC(conn);
                 break;
             case CANTP_RX_STATE_PROCESSED:
             case CANTP_RX_STATE_ABORT:
+            case CANTP_RX_STATE_INVALID:
+                CANTP_RX_ACTIVATION(conn) = CANTP_RX_WAIT;
                 nextState = CANTP_RX_STATE_FREE;
                 break;
         }
-        conn->state = nextState;
+        CanTp_RxSetState(conn, nextState);
     }
 }
 
-static void CanTp_ConnectionsTimersInc(void){
-    // Increments timers for each tx and rx connection
-    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.txConnections); connItr++){
-        CanTp_TxConnection *conn = &CanTp_State.txConnections[connItr];
-        conn->timer.as += CONFIG_CANTP_MAIN_FUNCTION_PERIOD;
-        conn->timer.bs += CONFIG_CANTP_MAIN_FUNCTION_PERIOD;
-        conn->timer.cs += CONFIG_CANTP_MAIN_FUNCTION_PERIOD;
+static void CanTp_TimerExpired(uint16 timerIdx, CanTp_TimerType type){
+    if (timerIdx >= CANTP_RX_CONNECTIONS_COUNT){
+        CanTp_TxConnection *conn = &CanTp_State.txConnections[timerIdx - CANTP_RX_CONNECTIONS_COUNT];
+
+        // N_As, N_Bs and N_Cs timeouts abort the transmission
+        Det_ReportRuntimeError(CANTP_MODULE_ID, 0, CANTP_MAIN_FUNCTION_API_ID, CANTP_E_TX_COM);
+        CanTp_TxSetState(conn, CanTp_TxStateCancel(conn));
+    } 
+    else{
+        CanTp_RxConnection *conn = &CanTp_State.rxConnections[timerIdx];
+
+        switch (type){
+            case CANTP_TIMER_N_AR:
+            case CANTP_TIMER_N_CR:
+                Det_ReportRuntimeError(CANTP_MODULE_ID, 0, CANTP_MAIN_FUNCTION_API_ID, CANTP_E_RX_COM);
+                // A reception PduR has not accepted yet is not indicated
+                if (!conn->startPending){
+                    PduR_CanTpRxIndication(conn->nsdu->id, E_NOT_OK);
+                }
+                CanTp_RxSetFcPending(conn, FALSE);
+                CanTp_RxSetState(conn, CANTP_RX_STATE_ABORT);
+                break;
+            case CANTP_TIMER_N_BR:
+                // Time for the next FC after an FC.WAIT, otherwise a performance requirement only
+                if (CANTP_RX_STATE(conn) == CANTP_RX_STATE_WAIT_BUFFER){
+                    CanTp_RxSetState(conn, CANTP_RX_STATE_FC_TX_REQ);
+                }
+                break;
+            default:
+                break;
+        }
     }
+}
 
-    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxConnections); connItr++){
-        CanTp_RxConnection *conn = &CanTp_State.rxConnections[connItr];
-        conn->timer.ar += CONFIG_CANTP_MAIN_FUNCTION_PERIOD;
-        conn->timer.br += CONFIG_CANTP_MAIN_FUNCTION_PERIOD;
-        conn->timer.cr += CONFIG_CANTP_MAIN_FUNCTION_PERIOD;
+static void CanTp_TimersProcess(void){
+    uint16 link = CanTp_State.timerWheel[(CanTp_State.currentTime / CONFIG_CANTP_MAIN_FUNCTION_PERIOD) % CONFIG_CANTP_TIMER_WHEEL_SIZE];
+
+    while (link != 0){
+        uint16 timerIdx = link - 1;
+        CanTp_Timer *timer = &CanTp_State.timers[timerIdx];
+        link = timer->next;
+
+        // Timers armed more than one wheel turn ahead share the bucket and stay armed
+        if ((sint32)(CanTp_State.currentTime - timer->deadline) >= 0){
+            CanTp_TimerType type = timer->type;
+            CanTp_TimerStop(timerIdx);
+            CanTp_TimerExpired(timerIdx, type);
+        }
     }
 }
 
@@ -796,13 +2417,28 @@ static void CanTp_ConnectionsTimersInc(void){
 
 */
 void CanTp_Init(const CanTp_ConfigType *CfgPtr){
-    PARAM_UNUSED(CfgPtr);
-    // rxConnections and txConnections have the same size
+    boolean buffersValid;
+
+    CanTp_State.config = (CfgPtr != NULL) ? CfgPtr : &CanTp_DefaultConfig;
     for(uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxConnections); connItr++){
-        CanTp_State.rxConnections[connItr].activation = CANTP_RX_WAIT;
-        CanTp_State.txConnections[connItr].activation = CANTP_TX_WAIT;
+        CANTP_RX_ACTIVATION(&CanTp_State.rxConnections[connItr]) = CANTP_RX_WAIT;
+        CANTP_RX_STATE(&CanTp_State.rxConnections[connItr]) = CANTP_RX_STATE_FREE;
+    }
+    for(uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.txConnections); connItr++){
+        CANTP_TX_ACTIVATION(&CanTp_State.txConnections[connItr]) = CANTP_TX_WAIT;
+        CANTP_TX_STATE(&CanTp_State.txConnections[connItr]) = CANTP_TX_STATE_FREE;
     }
-    CanTp_State.activation = CANTP_ON;
+    CanTp_LoadConfig(CanTp_State.config);
+    CanTp_ConnectionPoolsReset();
+    buffersValid = CanTp_AllocFrameBuffers();
+    for (uint32 timerItr = 0; timerItr < ARR_SIZE(CanTp_State.timers); timerItr++){
+        CanTp_State.timers[timerItr].type = CANTP_TIMER_NONE;
+    }
+    for (uint32 bucketItr = 0; bucketItr < ARR_SIZE(CanTp_State.timerWheel); bucketItr++){
+        CanTp_State.timerWheel[bucketItr] = 0;
+    }
+    CanTp_BuildPduIndexes();
+    CanTp_State.activation = (buffersValid && CanTp_RxNPduIdsValid()) ? CANTP_ON : CANTP_OFF;
     CanTp_State.currentTime = 0;
 }
 
@@ -815,10 +2451,11 @@ void CanTp_Init(const CanTp_ConfigType *CfgPtr){
 */
 void CanTp_Shutdown(void){
     CanTp_State.activation = CANTP_OFF;
-    // rxConnections and txConnections have the same size
     for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.rxConnections); connItr++){
-        CanTp_State.rxConnections[connItr].activation = CANTP_RX_WAIT;
-        CanTp_State.txConnections[connItr].activation = CANTP_TX_WAIT;
+        CANTP_RX_ACTIVATION(&CanTp_State.rxConnections[connItr]) = CANTP_RX_WAIT;
+    }
+    for (uint32 connItr = 0; connItr < ARR_SIZE(CanTp_State.txConnections); connItr++){
+        CANTP_TX_ACTIVATION(&CanTp_State.txConnections[connItr]) = CANTP_TX_WAIT;
     }
 }
 
@@ -831,17 +2468,18 @@ void CanTp_Shutdown(void){
 */
 Std_ReturnType CanTp_Transmit(PduIdType TxPduId, const PduInfoType *PduInfoPtr){
     Std_ReturnType result = E_NOT_OK;
-    CanTp_TxNSduType *nsdu = NULL;
+    const CanTp_TxNSduType *nsdu = NULL;
     uint32 maxNsduLength = 0;
+    CanTp_TxNSduSlot *slot = CanTp_TxNSduLookup(TxPduId);
     CanTp_TxConnection *connection = getTxConnection(TxPduId);
 
     if (!CANTP_IS_ON()){
         return result;
     }
-    if (connection == NULL){
+    if (slot == NULL){
         return result;
     }
-    if (connection->activation == CANTP_TX_PROCESSING){
+    if ((connection != NULL) && (CANTP_TX_ACTIVATION(connection) == CANTP_TX_PROCESSING)){
         return result;
     }
     if (PduInfoPtr == NULL){
@@ -850,20 +2488,56 @@ Std_ReturnType CanTp_Transmit(PduIdType TxPduId, const PduInfoType *PduInfoPtr){
     if ((PduInfoPtr->SduLength > 0) && (PduInfoPtr->SduDataPtr == NULL)){
         return result;
     }
+    // A half duplex channel does not transmit while it receives
+    if ((slot->channel != NULL) && (slot->channel->channelMode == CANTP_MODE_HALF_DUPLEX) &&
+        CanTp_ChannelBusy(slot->channel, CANTP_NSDU_DIRECTION_RX)){
+        return result;
+    }
+    if (connection == NULL){
+        connection = CanTp_TxBind(slot);
+        if (connection == NULL){
+            return result;
+        }
+    }
 
-    connection->activation = CANTP_TX_PROCESSING;
+    CANTP_TX_ACTIVATION(connection) = CANTP_TX_PROCESSING;
     nsdu = connection->nsdu;
-    maxNsduLength = determineMaxTxNsduLength(nsdu);
+    maxNsduLength = determineMaxTxNsduLength(connection);
     result = E_OK;
 
     // Only SF and FF transmission is triggered here. CF frames and FC are triggered from RX/TX state machines.
     if (PduInfoPtr->SduLength <= maxNsduLength){
-        connection->state = CANTP_TX_STATE_SF_SEND_REQ;
+        CanTp_TxSetState(connection, CANTP_TX_STATE_SF_SEND_REQ);
     } 
     else{
-        connection->state = CANTP_TX_STATE_FF_SEND_REQ;
+        CanTp_TxSetState(connection, CANTP_TX_STATE_FF_SEND_REQ);
     }
     connection->pduInfo.SduLength = PduInfoPtr->SduLength;
+    if (connection->layout.canIdAddr){
+        // CAN ID given by the upper layer, otherwise built from the configured addresses
+        if (PduInfoPtr->MetaDataPtr != NULL){
+            uint32 canId = CanTp_MetaDataToCanId(PduInfoPtr->MetaDataPtr);
+            connection->peerAddr = (uint8)(canId >> 8);
+            connection->localAddr = (uint8)canId;
+        } 
+        else{
+            connection->peerAddr = (nsdu->pNTa != NULL) ? nsdu->pNTa->nTa : 0U;
+            connection->localAddr = (nsdu->pNSa != NULL) ? nsdu->pNSa->nSa : 0U;
+        }
+        CanTp_CanIdToMetaData(CanTp_FixedCanId(nsdu->addressingFormat, nsdu->taType, connection->peerAddr, connection->localAddr), connection->metaData);
+    }
+    connection->staging.offset = 0;
+    connection->staging.count = 0;
+    connection->retry.TpDataStateType = TP_CONFPENDING;
+    connection->retry.TxTpDataCnt = 0;
+    connection->retryCount = 0;
+    connection->availableData = PduInfoPtr->SduLength;
+#if defined(CONFIG_CANTP_ZERO_COPY_TX)
+    // The SDU has to stay valid until PduR_CanTpTxConfirmation
+    connection->sduData = nsdu->zeroCopy ? PduInfoPtr->SduDataPtr : NULL;
+    connection->sduLength = PduInfoPtr->SduLength;
+    connection->sduOffset = 0;
+#endif
     return result;
 }
 
@@ -882,8 +2556,8 @@ Std_ReturnType CanTp_CancelTransmit(PduIdType TxPduId){
     if (!conn){
         return status;
     }
-    if (conn->activation == CANTP_TX_PROCESSING){
-        conn->state = CANTP_TX_STATE_CANCEL;
+    if (CANTP_TX_ACTIVATION(conn) == CANTP_TX_PROCESSING){
+        CanTp_TxSetState(conn, CANTP_TX_STATE_CANCEL);
         status = E_OK;
     }
     return status;
@@ -899,9 +2573,9 @@ Std_ReturnType CanTp_CancelTransmit(PduIdType TxPduId){
 Std_ReturnType CanTp_CancelReceive(PduIdType RxPduId){
     CanTp_RxConnection *conn = getRxConnection(RxPduId);
     if (conn != NULL){
-        if ((conn->activation == CANTP_RX_PROCESSING)){
-            conn->activation = CANTP_RX_WAIT;
-            conn->state = CANTP_RX_STATE_ABORT;
+        if ((CANTP_RX_ACTIVATION(conn) == CANTP_RX_PROCESSING)){
+            CANTP_RX_ACTIVATION(conn) = CANTP_RX_WAIT;
+            CanTp_RxSetState(conn, CANTP_RX_STATE_ABORT);
             PduR_CanTpRxIndication(conn->nsdu->id, E_NOT_OK);
             return E_OK;
         } 
@@ -923,15 +2597,16 @@ Std_ReturnType CanTp_CancelReceive(PduIdType RxPduId){
 */
 Std_ReturnType CanTp_ChangeParameter(PduIdType id, TPParameterType parameter, uint16 value){
     Std_ReturnType result = E_NOT_OK;
-    CanTp_RxConnection *conn = getRxConnection(id);
-    if ((conn != NULL) && (conn->activation == CANTP_RX_WAIT) && (conn->state == CANTP_RX_STATE_FREE) && (value <= 0xFF)){
+    CanTp_RxNSduSlot *slot = CanTp_RxNSduLookup(id);
+    // Parameters can not change while a reception is bound to the NSdu
+    if ((slot != NULL) && (slot->connIdx == CANTP_PDU_INDEX_INVALID) && (value <= 0xFF)){
         switch (parameter){
             case TP_STMIN:
-                conn->nsdu->STmin = value;
+                slot->stMin = value;
                 result = E_OK;
                 break;
             case TP_BS:
-                conn->nsdu->bs = value;
+                slot->bs = (uint8)value;
                 result = E_OK;
                 break;
             case TP_BC:
@@ -951,17 +2626,17 @@ Std_ReturnType CanTp_ChangeParameter(PduIdType id, TPParameterType parameter, ui
 */
 Std_ReturnType CanTp_ReadParameter(PduIdType id, TPParameterType parameter, uint16 *value){
     Std_ReturnType result = E_NOT_OK;
-    CanTp_RxConnection *conn = getRxConnection(id);
+    const CanTp_RxNSduSlot *slot = CanTp_RxNSduLookup(id);
 
-    if (conn != NULL){
+    if (slot != NULL){
         uint16 readVal;
         switch (parameter){
             case TP_STMIN:
-                readVal = conn->nsdu->STmin;
+                readVal = slot->stMin;
                 result = E_OK;
                 break;
             case TP_BS:
-                readVal = conn->nsdu->bs;
+                readVal = slot->bs;
                 result = E_OK;
                 break;
             case TP_BC:
@@ -990,7 +2665,8 @@ void CanTp_MainFunction(void){
     if (CANTP_IS_ON()){
         CanTp_TxIteration();
         CanTp_RxIteration();
-        CanTp_ConnectionsTimersInc();
+        // Deadlines armed in this period are due N periods later, not one period early
+        CanTp_TimersProcess();
         CanTp_State.currentTime += CONFIG_CANTP_MAIN_FUNCTION_PERIOD;
     }
 }
@@ -1006,12 +2682,31 @@ void CanTp_MainFunction(void){
 */
 void CanTp_RxIndication(PduIdType RxPduId, const PduInfoType *PduInfoPtr){
     CanTp_TxConnection *txConn = NULL;
-    CanTp_RxConnection *rxConn = getRxConnection(RxPduId);
+    CanTp_RxConnection *rxConn = NULL;
+    CanTp_RxNSduSlot *rxSlot = CanTp_RxNSduDemux(RxPduId, PduInfoPtr);
+    CanTp_FrameLayout rxLayout;
     uint8 nAeSize = 0;
+    CanTp_PciType frameType;
     CanTp_NSduDirection_t nsduDir = CANTP_NSDU_DIRECTION_RX;
-    CanTp_TxConnectionState nextState = CANTP_RX_STATE_FREE;
+    CanTp_RxConnectionState nextState = CANTP_RX_STATE_FREE;
 
-    if (rxConn == NULL){
+    if (!CANTP_IS_ON()){
+        return;
+    }
+    if (rxSlot == NULL){
+        if (CanTp_TxNSduLookup(RxPduId) == NULL){
+            return;
+        }
+        // FC is only of interest while a transmission is bound to the NSdu
+        txConn = getTxConnection(RxPduId);
+        if (txConn == NULL){
+            return;
+        }
+        nsduDir = CANTP_NSDU_DIRECTION_TX;
+    } 
+    else if ((PduInfoPtr->SduLength > CanTp_GetAddrFieldLen(rxSlot->nsdu->addressingFormat)) &&
+             (CanTp_DecodeFrameType(&(PduInfoPtr->SduDataPtr[CanTp_GetAddrFieldLen(rxSlot->nsdu->addressingFormat)])) == CANTP_N_PCI_TYPE_FC)){
+        // The N-PDU is shared by a reception and a transmission, the FC belongs to the transmission
         txConn = getTxConnection(RxPduId);
         if (txConn == NULL){
             return;
@@ -1020,13 +2715,44 @@ void CanTp_RxIndication(PduIdType RxPduId, const PduInfoType *PduInfoPtr){
     }
 
     if (nsduDir == CANTP_NSDU_DIRECTION_RX) {
-        if ((rxConn->nsdu->paddingActivation == CANTP_ON) && (PduInfoPtr->SduLength < 8)){
-            PduR_CanTpRxIndication(rxConn->nsdu->id, E_NOT_OK);
+        rxLayout = CanTp_RxLayoutOf(rxSlot->nsdu);
+        if (PduInfoPtr->SduLength < rxLayout.padLen){
+            PduR_CanTpRxIndication(rxSlot->nsdu->id, E_NOT_OK);
+            return;
+        }
+        nAeSize = rxLayout.nAe;
+        // No N_PCI byte after the address
+        if (PduInfoPtr->SduLength <= nAeSize){
+            return;
+        }
+        frameType = CanTp_DecodeFrameType(&(PduInfoPtr->SduDataPtr[nAeSize]));
+        // A half duplex channel does not start a reception while it transmits
+        if (((frameType == CANTP_N_PCI_TYPE_SF) || (frameType == CANTP_N_PCI_TYPE_FF)) && (rxSlot->channel != NULL) &&
+            (rxSlot->channel->channelMode == CANTP_MODE_HALF_DUPLEX) && CanTp_ChannelBusy(rxSlot->channel, CANTP_NSDU_DIRECTION_TX)){
             return;
         }
-        nAeSize = CanTp_GetAddrFieldLen(rxConn->nsdu->addressingFormat);
 
-        switch (CanTp_DecodeFrameType(&(PduInfoPtr->SduDataPtr[nAeSize]))){
+        if (rxLayout.canIdAddr && (PduInfoPtr->MetaDataPtr != NULL)){
+            rxConn = CanTp_RxPeerConnection(rxSlot, PduInfoPtr->MetaDataPtr, frameType);
+            if (rxConn == NULL){
+                return;
+            }
+        } 
+        else{
+            rxConn = (rxSlot->connIdx != CANTP_PDU_INDEX_INVALID) ? &CanTp_State.rxConnections[rxSlot->connIdx] : NULL;
+        }
+        if (rxConn == NULL){
+            // Only SF and FF start a reception, anything else is unexpected without a bound connection
+            if ((frameType != CANTP_N_PCI_TYPE_SF) && (frameType != CANTP_N_PCI_TYPE_FF)){
+                return;
+            }
+            rxConn = CanTp_RxBind(rxSlot);
+            if (rxConn == NULL){
+                return;
+            }
+        }
+
+        switch (frameType){
             case CANTP_N_PCI_TYPE_SF:
                 nextState = CanTp_RxIndSF(rxConn, PduInfoPtr, nAeSize);
                 break;
@@ -1041,20 +2767,43 @@ void CanTp_RxIndication(PduIdType RxPduId, const PduInfoType *PduInfoPtr){
                 return;
                 break;
         }
+        if ((nextState == CANTP_RX_STATE_FC_TX_REQ) && (rxConn->channel != NULL) && rxConn->channel->immediateDispatch){
+            nextState = CanTp_RxStateTXFC(rxConn);
+        }
+        // Each received frame restarts the timeout of the state it leads to (e.g. N_Cr between CFs)
+        CanTp_RxArmTimer(rxConn, nextState);
+        CanTp_RxSetState(rxConn, nextState);
     } 
     else if (nsduDir == CANTP_NSDU_DIRECTION_TX){
-        if (txConn->state != CANTP_TX_STATE_WAIT_FC){
+        if (CANTP_TX_STATE(txConn) != CANTP_TX_STATE_WAIT_FC){
+            return;
+        }
+        nAeSize = txConn->layout.nAe;
+        if (PduInfoPtr->SduLength <= nAeSize){
+            return;
+        }
+        // FC from another receiver than the one the CAN ID was sent to
+        if (txConn->layout.canIdAddr && (PduInfoPtr->MetaDataPtr != NULL)){
+            uint32 canId = CanTp_MetaDataToCanId(PduInfoPtr->MetaDataPtr);
+            if (((uint8)canId != txConn->peerAddr) || ((uint8)(canId >> 8) != txConn->localAddr)){
+                return;
+            }
+        }
+        // FC addressed to another sender on the same N-PDU
+        if (txConn->layout.checkAddr && ((PduInfoPtr->SduLength == 0) || (PduInfoPtr->SduDataPtr[0] != txConn->layout.rxAddr))){
             return;
         }
-        nAeSize = CanTp_GetAddrFieldLen(rxConn->nsdu->addressingFormat);
 
         if (CanTp_DecodeFrameType(&(PduInfoPtr->SduDataPtr[nAeSize])) == CANTP_N_PCI_TYPE_FC){
-            nextState = CanTp_RxIndFC(txConn, PduInfoPtr, nAeSize);
+            CanTp_TxConnectionState txNextState = CanTp_RxIndFC(txConn, PduInfoPtr, nAeSize);
+            // FC.WAIT restarts N_Bs
+            CanTp_TxArmTimer(txConn, txNextState);
+            CanTp_TxSetState(txConn, txNextState);
+            CanTp_TxDispatchCF(txConn);
         } 
         else{
             return;
         }
-        txConn->state = nextState;
     }
     return;
 }
@@ -1068,18 +2817,55 @@ void CanTp_RxIndication(PduIdType RxPduId, const PduInfoType *PduInfoPtr){
 */
 void CanTp_TxConfirmation(PduIdType TxPduId, Std_ReturnType result){
     CanTp_TxConnection *conn = getTxConnection(TxPduId);
+    CanTp_RxConnection *rxConn = CanTp_RxFcPendingConnection(TxPduId);
 
+    // FC sent by a reception. CanIf confirms the N-PDUs sharing a PduId in the order they were handed to it
+    if ((rxConn != NULL) && ((conn == NULL) || (CANTP_TX_STATE(conn) != CANTP_TX_STATE_WAIT_CANIF_CONFIRM) ||
+                             ((sint32)(rxConn->fcSeq - conn->confirmSeq) < 0))){
+        CanTp_RxFcConfirmation(rxConn, result);
+        return;
+    }
     if (conn == NULL){
         return;
     }
 
     if (result == E_OK){
-        if (conn->activation == CANTP_TX_PROCESSING && conn->state != CANTP_TX_STATE_FREE){
+        if (CANTP_TX_ACTIVATION(conn) == CANTP_TX_PROCESSING && CANTP_TX_STATE(conn) == CANTP_TX_STATE_WAIT_CANIF_CONFIRM){
+            conn->retryCount = 0;
+            CanTp_TxSetState(conn, CanTp_TxStateConfirmed(conn));
+            CanTp_TxDispatchCF(conn);
         }
     } 
     else{
-        if (conn->activation == CANTP_TX_PROCESSING && conn->state != CANTP_TX_STATE_FREE){
-            conn->state = CANTP_TX_STATE_CANCEL;
+#if CONFIG_CANTP_TX_RETRY_MAX > 0
+        if ((CANTP_TX_ACTIVATION(conn) == CANTP_TX_PROCESSING) && (CANTP_TX_STATE(conn) == CANTP_TX_STATE_WAIT_CANIF_CONFIRM) &&
+            (conn->retryCount < CONFIG_CANTP_TX_RETRY_MAX)){
+            // The lost N-PDU is sent again
+            conn->retryCount++;
+            CanTp_TxSetState(conn, CanTp_TxRewindFrame(conn));
+            return;
+        }
+#endif
+        if (CANTP_TX_ACTIVATION(conn) == CANTP_TX_PROCESSING && CANTP_TX_STATE(conn) != CANTP_TX_STATE_FREE){
+            CanTp_TxSetState(conn, CANTP_TX_STATE_CANCEL);
         }
     }
 }
+
+
+/**
+  @brief CanTp_GetPoolStats
+
+  Reports the usage of the rx and tx connection pools. Either pointer may be NULL.
+
+*/
+void CanTp_GetPoolStats(CanTp_PoolStatsType *RxStats, CanTp_PoolStatsType *TxStats){
+    if (RxStats != NULL){
+        *RxStats = CanTp_State.rxPoolStats;
+        RxStats->inUse = (uint16)CanTp_State.rxActiveCount;
+    }
+    if (TxStats != NULL){
+        *TxStats = CanTp_State.txPoolStats;
+        TxStats->inUse = (uint16)CanTp_State.txActiveCount;
+    }
+}
@@ -14,6 +14,7 @@
 /**
  * @brief Runtime Errors
  */
+#define CANTP_E_INIT_FAILED 0x04
 #define CANTP_E_PADDING 0x70
 #define CANTP_E_INVALID_TATYPE 0x90
 #define CANTP_E_OPER_NOT_SUPPORTED 0xA0
@@ -46,5 +47,6 @@ Std_ReturnType CanTp_ReadParameter(PduIdType id, TPParameterType parameter, uint
 void CanTp_MainFunction(void);
 void CanTp_RxIndication(PduIdType RxPduId, const PduInfoType *PduInfoPtr);
 void CanTp_TxConfirmation(PduIdType TxPduId, Std_ReturnType result);
+void CanTp_GetPoolStats(CanTp_PoolStatsType *RxStats, CanTp_PoolStatsType *TxStats);
 
 #endif /* CAN_TP_H */
\ No newline at end of file
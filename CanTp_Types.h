@@ -7,10 +7,18 @@
 
 #include "ComStack_Types.h"
 
+#ifndef CONFIG_CAN_TP_MAX_CHANNELS_COUNT
 #define CONFIG_CAN_TP_MAX_CHANNELS_COUNT (uint32)8
+#endif
+#ifndef CONFIG_CANTP_MAX_TX_NSDU_PER_CHANNEL
 #define CONFIG_CANTP_MAX_TX_NSDU_PER_CHANNEL (uint32)5
+#endif
+#ifndef CONFIG_CANTP_MAX_RX_NSDU_PER_CHANNEL
 #define CONFIG_CANTP_MAX_RX_NSDU_PER_CHANNEL (uint32)5
+#endif
 #define CONFIG_CANTP_MAIN_FUNCTION_PERIOD (uint32)1
+// Number of MainFunction periods covered by one turn of the timer wheel
+#define CONFIG_CANTP_TIMER_WHEEL_SIZE (uint32)64
 #define CONFIG_CAN_2_0_OR_CAN_FD
 // #define CONFIG_CAN_FD_ONLY
 #if defined(CONFIG_CAN_2_0_OR_CAN_FD)
@@ -19,6 +27,46 @@
 #define CANTP_CAN_FRAME_SIZE 64
 #endif
 
+// Value of the bytes filling up padded frames
+#ifndef CONFIG_CANTP_PADDING_BYTE
+#define CONFIG_CANTP_PADDING_BYTE (uint8)0xCC
+#endif
+
+// Retransmissions of an N-PDU CanIf failed to send (CanTp_TxConfirmation with E_NOT_OK), 0 aborts the transfer.
+// Plain number, it is tested by the preprocessor
+#ifndef CONFIG_CANTP_TX_RETRY_MAX
+#define CONFIG_CANTP_TX_RETRY_MAX 0
+#endif
+
+// Enables the zero-copy transmit path of TxNSdus with zeroCopy set, requires CanIf_TransmitGather
+// #define CONFIG_CANTP_ZERO_COPY_TX
+
+// Keeps the state and activation of the connections in dense arrays separate from the rest of the connection data
+// #define CONFIG_CANTP_SOA_LAYOUT
+
+// Runtime connections shared by all NSdus, bounds the number of concurrent transfers in each direction
+#ifndef CONFIG_CANTP_RX_CONNECTIONS_COUNT
+#define CONFIG_CANTP_RX_CONNECTIONS_COUNT (uint32)8
+#endif
+#ifndef CONFIG_CANTP_TX_CONNECTIONS_COUNT
+#define CONFIG_CANTP_TX_CONNECTIONS_COUNT (uint32)8
+#endif
+
+// Bytes shared by the connection buffers, carved in CanTp_Init for the largest maxFrameLen, txStagingSize and
+// rxReassemblySize of the NSdus. The default holds a frame per tx connection and an FC and FF frame per rx connection,
+// longer CAN FD frames, staging and reassembly need a larger pool
+#ifndef CONFIG_CANTP_FRAME_BUFFER_POOL_SIZE
+#define CONFIG_CANTP_FRAME_BUFFER_POOL_SIZE \
+    (uint32)((CONFIG_CANTP_TX_CONNECTIONS_COUNT * CANTP_CAN_FRAME_SIZE) + (CONFIG_CANTP_RX_CONNECTIONS_COUNT * (8 + CANTP_CAN_FRAME_SIZE)))
+#endif
+
+// What happens to an SF/FF when all rx connections are bound
+#define CANTP_POOL_REJECT 0
+#define CANTP_POOL_EVICT_OLDEST 1
+#ifndef CONFIG_CANTP_RX_POOL_EXHAUSTION_POLICY
+#define CONFIG_CANTP_RX_POOL_EXHAUSTION_POLICY CANTP_POOL_REJECT
+#endif
+
 #if defined(CONFIG_CAN_2_0_OR_CAN_FD) && defined(CONFIG_CAN_FD_ONLY)
 #error                                                                                             \
     "CanTp Configuration Error: Only one of those can be defined at a time CONFIG_CAN_2_0_OR_CAN_FD or CONFIG_CAN_FD_ONLY"
@@ -41,6 +89,12 @@ typedef enum
     CANTP_OFF
 } CanTp_PaddingActivationType;
 
+typedef enum
+{
+    CANTP_MODE_FULL_DUPLEX = 0,
+    CANTP_MODE_HALF_DUPLEX
+} CanTp_ChannelModeType;
+
 typedef enum
 {
     CANTP_TX_WAIT,
@@ -104,12 +158,23 @@ typedef struct
     uint16 id;
     CanTp_PaddingActivationType paddingActivation;
     CanTp_TaTypeType taType;
+    // FC.WAIT sent in a row before a reception is given up, 0 aborts instead of waiting
     uint16 wftMax;
     uint32 STmin;
+    // Length of the CAN frames received on this NSdu (8 for CAN 2.0, up to 64 for CAN FD), 0 means CANTP_CAN_FRAME_SIZE
+    uint8 maxFrameLen;
+    // Bytes of CF payload collected before PduR_CanTpCopyRxData is called (at the latest at the end of a block), 0 copies each CF
+    uint16 rxReassemblySize;
+    // Size each FC.CTS block to the buffer PduR reported, at most bs CFs (bs = 0: no limit). FC.WAIT only when no CF fits.
+    // PduR may then stream the SDU through a window smaller than the message, wftMax covers a window drained too slowly
+    boolean adaptiveBs;
     PduIdType ref;
     const CanTp_NAeType *pNAe;
     const CanTp_NSaType *pNSa;
     const CanTp_NTaType *pNTa;
+    // N-PDU shared with other NSdus (extended/mixed addressing), NULL receives on the N-PDU with the NSdu id.
+    // CanTp_RxIndication takes N-PDU ids, so a shared N-PDU id may only be the id of an NSdu sharing
+    // that N-PDU; CanTp_Init reports CANTP_E_INIT_FAILED and leaves the module off for any other configuration
     const CanTp_NPduType *rxNPdu;
     const CanTp_FcNPduType *txFcNPdu;
 } CanTp_RxNSduType;
@@ -117,19 +182,20 @@ typedef struct
 typedef struct
 {
     /**
-     * @brief Value in second of the N_As timeout. N_As is the time for
+     * @brief Value in milliseconds of the N_As timeout. N_As is the time for
      * transmission of a CAN frame (any N_PDU) on the part of the sender.
+     * 0 disables the supervision (same for all N_Ax/N_Bx/N_Cx timeouts).
      */
     uint32 nas;
 
     /**
-     * @brief Value in seconds of the N_Bs timeout. N_Bs is the time of
+     * @brief Value in milliseconds of the N_Bs timeout. N_Bs is the time of
      * transmission until reception of the next Flow Control N_PDU.
      */
     uint32 nbs;
 
     /**
-     * @brief Value in seconds of the performance requirements relating to N_Cs.
+     * @brief Value in milliseconds of the performance requirements relating to N_Cs.
      * CanTpNcs is the time in which CanTp is allowed to request from PduR the
      * Tx data of a Consecutive Frame N_PDU.
      */
@@ -154,8 +220,9 @@ typedef struct
     uint16 id;
 
     /**
-     * @brief Defines if the transmit frame use padding or not. This parameter
-     * is restricted to 8 byte N-PDUs.
+     * @brief Defines if the transmit frame use padding or not. Padded frames are
+     * filled up to 8 bytes with CONFIG_CANTP_PADDING_BYTE. CAN FD frames above
+     * 8 bytes are always filled up to the next DLC.
      */
     CanTp_PaddingActivationType paddingActivation;
 
@@ -166,6 +233,29 @@ typedef struct
      */
     CanTp_TaTypeType taType;
 
+    /**
+     * @brief Length of the CAN frames sent for this TxNSdu, 8 for CAN 2.0
+     * and up to 64 for CAN FD. 0 selects CANTP_CAN_FRAME_SIZE.
+     */
+    uint8 maxFrameLen;
+
+    /**
+     * @brief The SduDataPtr given to CanTp_Transmit is kept until the transmission
+     * is confirmed and N-PDUs are gathered by CanIf from it, without
+     * PduR_CanTpCopyTxData. Used only with CONFIG_CANTP_ZERO_COPY_TX, a NULL
+     * SduDataPtr falls back to copying.
+     */
+    boolean zeroCopy;
+
+    /**
+     * @brief Size in bytes of the buffer the CF data is prefetched into.
+     * PduR_CanTpCopyTxData is called once per block (BS CFs, or the whole
+     * buffer for BS = 0) instead of once per CF. 0 disables prefetching.
+     * Each tx connection takes a buffer of the largest txStagingSize from
+     * CONFIG_CANTP_FRAME_BUFFER_POOL_SIZE.
+     */
+    uint16 txStagingSize;
+
     /**
      * @brief Reference to a Pdu in the COM-Stack.
      */
@@ -184,6 +274,31 @@ typedef struct
 
 typedef struct
 {
+    /**
+     * @brief Full duplex channels receive a segmented message while another
+     * one is transmitted. Half duplex channels ignore an SF/FF while one of
+     * their TxNSdus is transmitting and reject CanTp_Transmit while one of
+     * their RxNSdus is receiving.
+     */
+    CanTp_ChannelModeType channelMode;
+
+    /**
+     * @brief Advance the state machines directly from CanTp_RxIndication and
+     * CanTp_TxConfirmation (FC after FF/last CF of a block, next CF after FC or
+     * CF confirmation) instead of waiting for the next CanTp_MainFunction.
+     */
+    boolean immediateDispatch;
+
+    /**
+     * @brief Maximum number of CFs a single transfer on this channel may send
+     * in one CanTp_MainFunction period (0 is handled as 1). CFs within the
+     * budget are still separated by the STmin requested by the receiver.
+     * The next CF is only sent once the previous one is confirmed, so a burst
+     * needs a CanIf confirming from within CanIf_Transmit. With a CanIf
+     * confirming later each period sends one CF, use immediateDispatch to
+     * send the next CF from the confirmation.
+     */
+    uint8 maxCfPerTick;
     uint32 rxNSduCount;
     uint32 txNSduCount;
     CanTp_RxNSduType rxNSdu[CONFIG_CANTP_MAX_RX_NSDU_PER_CHANNEL];
@@ -195,4 +310,17 @@ typedef struct
     CanTp_ChannelType channels[CONFIG_CAN_TP_MAX_CHANNELS_COUNT];
 } CanTp_ConfigType;
 
+typedef struct
+{
+    // Connections in the pool
+    uint16 size;
+    // Connections bound to an NSdu now and the most ever bound at once
+    uint16 inUse;
+    uint16 peakInUse;
+    // SF/FF/Transmit requests which found no free connection
+    uint32 exhaustedCount;
+    // Receptions aborted by CANTP_POOL_EVICT_OLDEST
+    uint32 evictedCount;
+} CanTp_PoolStatsType;
+
 #endif /* CAN_TP_TYPES_H */
\ No newline at end of file
@@ -7,10 +7,23 @@
 /*====================================================================================================================*\
     Includes
 \*====================================================================================================================*/
+// Optional paths covered by the tests
+#define CONFIG_CANTP_ZERO_COPY_TX
+#define CONFIG_CANTP_RX_CONNECTIONS_COUNT (uint32)4
+#define CONFIG_CANTP_TX_CONNECTIONS_COUNT (uint32)4
+#define CONFIG_CANTP_RX_POOL_EXHAUSTION_POLICY CANTP_POOL_EVICT_OLDEST
+#define CONFIG_CANTP_TX_RETRY_MAX 2
+// Room for CAN FD frames, the staging and reassembly buffers
+#define CONFIG_CANTP_FRAME_BUFFER_POOL_SIZE (uint32)1024
+
 #include "fff.h"
 
 DEFINE_FFF_GLOBALS; 
 
+// Every test starts from the default configuration
+static void UT_LoadConfig(void);
+#define TEST_INIT UT_LoadConfig()
+
 #include "acutest.h"
 #include "Std_Types.h"
 
@@ -24,6 +37,12 @@ DEFINE_FFF_GLOBALS;
 \*====================================================================================================================*/
 #define PDU_INVALID (PduIdType)0xFFFFFFFF
 
+// Writable copy of CanTp_DefaultConfig the tests adjust before CanTp_Init
+static CanTp_ConfigType config;
+static void UT_LoadConfig(void){
+    memcpy(&config, &CanTp_DefaultConfig, sizeof(config));
+}
+
 #define PDU_PAYLOAD_LEN_1 6
 #define PDU_ID_1 102
 
@@ -40,17 +59,28 @@ static PduIdType findNextValidTxPduId(void){
     PduIdType pduId = PDU_INVALID;
 
     for (connItr = 0; pduId == PDU_INVALID; connItr++){
-        if (CanTp_State.txConnections[connItr].nsdu){
-            pduId = CanTp_State.txConnections[connItr].nsdu->id;
+        if (CanTp_State.txNSdus[connItr].nsdu){
+            pduId = CanTp_State.txNSdus[connItr].nsdu->id;
             break;
         }
-        connItr = connItr % ARR_SIZE(CanTp_State.txConnections);
+        connItr = connItr % ARR_SIZE(CanTp_State.txNSdus);
     }
     TEST_ASSERT(pduId != PDU_INVALID);
 
     return pduId;
 }
 
+// State of the connection bound to the NSdu, an NSdu without one is idle
+static CanTp_TxConnectionState txStateOf(PduIdType pduId){
+    CanTp_TxConnection *conn = getTxConnection(pduId);
+    return (conn != NULL) ? CANTP_TX_STATE(conn) : CANTP_TX_STATE_FREE;
+}
+
+static CanTp_RxConnectionState rxStateOf(PduIdType pduId){
+    CanTp_RxConnection *conn = getRxConnection(pduId);
+    return (conn != NULL) ? CANTP_RX_STATE(conn) : CANTP_RX_STATE_FREE;
+}
+
 /*====================================================================================================================*\
     Fake functions and mocks
 \*====================================================================================================================*/
@@ -62,6 +92,7 @@ FAKE_VALUE_FUNC(Std_ReturnType, Det_ReportRuntimeError, uint16, uint8, uint8, ui
   @brief Fake functions do CanIf.h
 */
 FAKE_VALUE_FUNC(Std_ReturnType, CanIf_Transmit, PduIdType, const PduInfoType *);
+FAKE_VALUE_FUNC(Std_ReturnType, CanIf_TransmitGather, PduIdType, const PduInfoType *, const PduInfoType *);
 /**
   @brief Fake functions do PduR_CanTp.h
 */
@@ -86,6 +117,111 @@ static BufReq_ReturnType PduR_CanTpCopyRxData_MOCK(PduIdType rxPduId, const PduI
     return BUFREQ_OK;
 }
 
+// Receive buffer PduR has left, reported by the mocks below
+static PduLengthType rxBufferLeft;
+static BufReq_ReturnType PduR_CanTpStartOfReception_BUFFER_MOCK(PduIdType pduId, const PduInfoType *pPduInfo, PduLengthType tpSduLength, PduLengthType *pBufferSize){
+    *pBufferSize = rxBufferLeft;
+    return BUFREQ_OK;
+}
+// Number of PduR_CanTpStartOfReception calls answered with BUFREQ_BUSY before the buffer is given
+static uint8 rxStartBusyCount;
+static BufReq_ReturnType PduR_CanTpStartOfReception_BUSY_MOCK(PduIdType pduId, const PduInfoType *pPduInfo, PduLengthType tpSduLength, PduLengthType *pBufferSize){
+    if (rxStartBusyCount != 0){
+        rxStartBusyCount--;
+        return BUFREQ_BUSY;
+    }
+    *pBufferSize = rxBufferLeft;
+    return BUFREQ_OK;
+}
+static BufReq_ReturnType PduR_CanTpCopyRxData_BUFFER_MOCK(PduIdType rxPduId, const PduInfoType *pPduInfo, PduLengthType *pBuffer){
+    rxBufferLeft -= pPduInfo->SduLength;
+    *pBuffer = rxBufferLeft;
+    return BUFREQ_OK;
+}
+
+// PduR passing the data on as it arrives, the free buffer stays at rxBufferLeft
+static PduLengthType rxStreamedBytes;
+static BufReq_ReturnType PduR_CanTpCopyRxData_STREAM_MOCK(PduIdType rxPduId, const PduInfoType *pPduInfo, PduLengthType *pBuffer){
+    rxStreamedBytes += pPduInfo->SduLength;
+    *pBuffer = rxBufferLeft;
+    return BUFREQ_OK;
+}
+
+static PduLengthType txDataLeft;
+static BufReq_ReturnType PduR_CanTpCopyTxData_MOCK(PduIdType txPduId, const PduInfoType *pPduInfo, const RetryInfoType *pRetryInfo, PduLengthType *pAvailableData){
+    txDataLeft -= pPduInfo->SduLength;
+    *pAvailableData = txDataLeft;
+    return BUFREQ_OK;
+}
+
+// Provides consecutive byte values, so the order of the data on the bus can be checked
+static uint8 txDataNext;
+static BufReq_ReturnType PduR_CanTpCopyTxData_SEQ_MOCK(PduIdType txPduId, const PduInfoType *pPduInfo, const RetryInfoType *pRetryInfo, PduLengthType *pAvailableData){
+    for (PduLengthType i = 0; i < pPduInfo->SduLength; i++){
+        pPduInfo->SduDataPtr[i] = txDataNext++;
+    }
+    return PduR_CanTpCopyTxData_MOCK(txPduId, pPduInfo, pRetryInfo, pAvailableData);
+}
+
+// PduR streaming the SDU, it never holds more than txStreamWindow bytes ahead of CanTp
+static PduLengthType txStreamWindow;
+static BufReq_ReturnType PduR_CanTpCopyTxData_STREAM_MOCK(PduIdType txPduId, const PduInfoType *pPduInfo, const RetryInfoType *pRetryInfo, PduLengthType *pAvailableData){
+    if (pPduInfo->SduLength > txStreamWindow){
+        return BUFREQ_BUSY;
+    }
+    PduR_CanTpCopyTxData_MOCK(txPduId, pPduInfo, pRetryInfo, pAvailableData);
+    *pAvailableData = (txDataLeft < txStreamWindow) ? txDataLeft : txStreamWindow;
+    return BUFREQ_OK;
+}
+
+// Retry info of the PduR_CanTpCopyTxData calls, the pointer passed by CanTp is reused between the calls
+static RetryInfoType txRetryHistory[16];
+static BufReq_ReturnType PduR_CanTpCopyTxData_RETRY_MOCK(PduIdType txPduId, const PduInfoType *pPduInfo, const RetryInfoType *pRetryInfo, PduLengthType *pAvailableData){
+    uint32 callIdx = (PduR_CanTpCopyTxData_fake.call_count - 1) % 16;
+    txRetryHistory[callIdx] = *pRetryInfo;
+    if (pRetryInfo->TpDataStateType == TP_DATARETRY){
+        txDataLeft += pRetryInfo->TxTpDataCnt;
+    }
+    return PduR_CanTpCopyTxData_MOCK(txPduId, pPduInfo, pRetryInfo, pAvailableData);
+}
+
+// Copies of the frames passed to CanIf_Transmit
+static uint8 canIfFrames[16][64];
+static PduLengthType canIfFrameLen[16];
+// CAN ID from the CAN_ID_32 meta data of the frames, 0 without meta data
+static uint32 canIfCanId[16];
+static Std_ReturnType CanIf_Transmit_MOCK(PduIdType txPduId, const PduInfoType *pPduInfo){
+    uint32 frameIdx = (CanIf_Transmit_fake.call_count - 1) % 16;
+    memcpy(canIfFrames[frameIdx], pPduInfo->SduDataPtr, pPduInfo->SduLength);
+    canIfFrameLen[frameIdx] = pPduInfo->SduLength;
+    canIfCanId[frameIdx] = (pPduInfo->MetaDataPtr != NULL) ? CanTp_MetaDataToCanId(pPduInfo->MetaDataPtr) : 0;
+    return E_OK;
+}
+// Frame confirmed by the driver before CanIf_Transmit returns
+static Std_ReturnType CanIf_Transmit_CONFIRM_MOCK(PduIdType txPduId, const PduInfoType *pPduInfo){
+    CanIf_Transmit_MOCK(txPduId, pPduInfo);
+    CanTp_TxConfirmation(txPduId, E_OK);
+    return E_OK;
+}
+// Deepest nesting of CanIf_Transmit calls made from the confirmations of CanIf_Transmit_CONFIRM_MOCK
+static uint32 canIfDepth;
+static uint32 canIfDepthMax;
+static Std_ReturnType CanIf_Transmit_DEPTH_MOCK(PduIdType txPduId, const PduInfoType *pPduInfo){
+    canIfDepth++;
+    canIfDepthMax = (canIfDepth > canIfDepthMax) ? canIfDepth : canIfDepthMax;
+    CanIf_Transmit_CONFIRM_MOCK(txPduId, pPduInfo);
+    canIfDepth--;
+    return E_OK;
+}
+static Std_ReturnType CanIf_TransmitGather_MOCK(PduIdType txPduId, const PduInfoType *pHeader, const PduInfoType *pPayload){
+    uint32 frameIdx = (CanIf_TransmitGather_fake.call_count - 1) % 16;
+    memcpy(canIfFrames[frameIdx], pHeader->SduDataPtr, pHeader->SduLength);
+    memcpy(&canIfFrames[frameIdx][pHeader->SduLength], pPayload->SduDataPtr, pPayload->SduLength);
+    canIfFrameLen[frameIdx] = pHeader->SduLength + pPayload->SduLength;
+    CanTp_TxConfirmation(txPduId, E_OK);
+    return E_OK;
+}
+
 /*====================================================================================================================*\
     Unit Tests
 \*====================================================================================================================*/
@@ -99,6 +235,7 @@ void Test_Of_CanTp_Shutdown(void){
     uint8 data[] = {1,2,3,4,5,6,7,8,9,10};
     PduInfoType pduInfo = {.SduDataPtr = data, .SduLength = ARR_SIZE(data)};
 
+    CanTp_Init(&config);
     PduIdType pduId = findNextValidTxPduId();
     CanTp_State.activation = CANTP_ON;
 
@@ -110,11 +247,11 @@ void Test_Of_CanTp_Shutdown(void){
     TEST_CHECK(CanTp_State.activation == CANTP_OFF);
 
     for (int i=0; i < ARR_SIZE(CanTp_State.rxConnections); i++){
-        TEST_CHECK(CanTp_State.rxConnections[i].activation == CANTP_RX_WAIT);
+        TEST_CHECK(CANTP_RX_ACTIVATION(&CanTp_State.rxConnections[i]) == CANTP_RX_WAIT);
     }
 
     for (int i=0; i < ARR_SIZE(CanTp_State.txConnections); i++){
-        TEST_CHECK(CanTp_State.txConnections[i].activation == CANTP_TX_WAIT);
+        TEST_CHECK(CANTP_TX_ACTIVATION(&CanTp_State.txConnections[i]) == CANTP_TX_WAIT);
     }
 }
 
@@ -124,9 +261,11 @@ void TestOf_CanTp_Transmit(void){
     uint8 sdu[] = {0xF, 0xA, 0xD, 0xE, 0xD};
     PduInfoType pduInfo = {.SduDataPtr = sdu, .SduLength = ARR_SIZE(sdu),};
 
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_CONFIRM_MOCK;
+    CanTp_Init(&config);
     PduIdType pduId = findNextValidTxPduId();
     Std_ReturnType transmitResult;
-    uint8 sduLengthPassedToCanIf = ARR_SIZE(sdu) + 1; // 5 payload bytes + 1 CanTp header byte
+    uint8 sduLengthPassedToCanIf = CAN_2_0_MAX_LEN; // 5 payload bytes + 1 CanTp header byte, padded to 8
 
     CanTp_State.activation = CANTP_ON;
     transmitResult = CanTp_Transmit(pduId, &pduInfo);
@@ -139,7 +278,8 @@ void TestOf_CanTp_Transmit(void){
     TEST_CHECK(CanIf_Transmit_fake.call_count == 1);
     TEST_CHECK(CanIf_Transmit_fake.arg0_val == pduId);
 
-    TEST_CHECK(((PduInfoType *)CanIf_Transmit_fake.arg1_val)->SduLength == sduLengthPassedToCanIf);
+    TEST_CHECK(canIfFrameLen[0] == sduLengthPassedToCanIf);
+    TEST_CHECK(canIfFrames[0][6] == CONFIG_CANTP_PADDING_BYTE && canIfFrames[0][7] == CONFIG_CANTP_PADDING_BYTE);
 
     // Verification of PduR_CanTpCopyTxData usage
     TEST_CHECK(PduR_CanTpCopyTxData_fake.call_count == 1);
@@ -155,6 +295,7 @@ void TestOf_CanTp_Transmit(void){
 void TestOf_CanTp_CancelTransmit(void){
     uint8 data[] = {1,2,3,4,5,6,7,8,9,10};
     PduInfoType pduInfo = {.SduDataPtr = data, .SduLength = ARR_SIZE(data)};
+    CanTp_Init(&config);
     PduIdType pduId = findNextValidTxPduId();
 
     CanTp_State.activation = CANTP_ON;
@@ -164,7 +305,7 @@ void TestOf_CanTp_CancelTransmit(void){
     TEST_CHECK(E_OK == CanTp_CancelTransmit(pduId));
 
     CanTp_MainFunction();
-    TEST_CHECK(getTxConnection(pduId)->activation == CANTP_TX_WAIT);
+    TEST_CHECK(getTxConnection(pduId) == NULL);
 }
 
 
@@ -173,10 +314,12 @@ void TestOf_CanTp_CancelReceive(void){
     PduInfoType pdu = {.SduDataPtr = pduPayload, .MetaDataPtr = NULL, .SduLength = PDU_PAYLOAD_LEN_1,};
     CanTp_RxNSduType test_nsdu = {.id = PDU_ID_1, .paddingActivation = CANTP_OFF, .addressingFormat = CANTP_STANDARD, .STmin = 100};
     config.channels[0].rxNSdu[1] = test_nsdu;
+    CanTp_Init(&config);
+    CanTp_RxConnection *conn = CanTp_RxBind(&CanTp_State.rxNSdus[1]);
     
     // TEST 1 - valid connection
-    CanTp_State.rxConnections[1].activation = CANTP_RX_PROCESSING;
-    CanTp_State.rxConnections[1].state = CANTP_RX_STATE_FC_TX_REQ;
+    CANTP_RX_ACTIVATION(conn) = CANTP_RX_PROCESSING;
+    CANTP_RX_STATE(conn) = CANTP_RX_STATE_FC_TX_REQ;
 
     TEST_CHECK(CanTp_CancelReceive(PDU_ID_1) == E_OK);
 
@@ -184,18 +327,18 @@ void TestOf_CanTp_CancelReceive(void){
     TEST_CHECK(PduR_CanTpRxIndication_fake.arg0_val == PDU_ID_1);
     TEST_CHECK(PduR_CanTpRxIndication_fake.arg1_val == E_NOT_OK);
 
-    TEST_CHECK(CanTp_State.rxConnections[1].activation == CANTP_RX_WAIT);
-    TEST_CHECK(CanTp_State.rxConnections[1].state == CANTP_RX_STATE_ABORT);
+    TEST_CHECK(CANTP_RX_ACTIVATION(conn) == CANTP_RX_WAIT);
+    TEST_CHECK(CANTP_RX_STATE(conn) == CANTP_RX_STATE_ABORT);
     
     // TEST 2 - invalid connection state
-    CanTp_State.rxConnections[1].activation = CANTP_RX_WAIT;
-    CanTp_State.rxConnections[1].state = CANTP_RX_STATE_FC_TX_REQ;
+    CANTP_RX_ACTIVATION(conn) = CANTP_RX_WAIT;
+    CANTP_RX_STATE(conn) = CANTP_RX_STATE_FC_TX_REQ;
 
     TEST_CHECK(CanTp_CancelReceive(PDU_ID_1) == E_NOT_OK);
 
     TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 1);        // 1 because call_count = 1 after test 1
-    TEST_CHECK(CanTp_State.rxConnections[1].activation == CANTP_RX_WAIT);
-    TEST_CHECK(CanTp_State.rxConnections[1].state == CANTP_RX_STATE_FC_TX_REQ);
+    TEST_CHECK(CANTP_RX_ACTIVATION(conn) == CANTP_RX_WAIT);
+    TEST_CHECK(CANTP_RX_STATE(conn) == CANTP_RX_STATE_FC_TX_REQ);
     getRxConnection(300);
 
     // TEST 3 - invalid connection
@@ -209,28 +352,31 @@ void TestOf_CanTp_ChangeParameter(void){
     PduInfoType pdu = {.SduDataPtr = pduPayload, .MetaDataPtr = NULL, .SduLength = PDU_PAYLOAD_LEN_1,};
     CanTp_RxNSduType test_nsdu = {.id = PDU_ID_1, .paddingActivation = CANTP_OFF, .addressingFormat = CANTP_STANDARD, .bs = 100};
     config.channels[0].rxNSdu[1] = test_nsdu;
+    CanTp_Init(&config);
     uint16 value = 123;
     
      // TEST 1 - invalid state
-    CanTp_State.rxConnections[1].activation = CANTP_RX_PROCESSING;
+    CanTp_RxConnection *conn = CanTp_RxBind(&CanTp_State.rxNSdus[1]);
+    CANTP_RX_ACTIVATION(conn) = CANTP_RX_PROCESSING;
 
     TEST_CHECK(CanTp_ChangeParameter(PDU_ID_1, TP_BS, value) == E_NOT_OK);
-    TEST_CHECK(CanTp_State.rxConnections[1].nsdu->bs == 100);
+    TEST_CHECK(CanTp_State.rxNSdus[1].bs == 100);
 
     // TEST 2 - valid
-    CanTp_State.rxConnections[1].activation = CANTP_RX_WAIT;
+    CANTP_RX_ACTIVATION(conn) = CANTP_RX_WAIT;
+    CanTp_RxSetState(conn, CANTP_RX_STATE_FREE);
 
     TEST_CHECK(CanTp_ChangeParameter(PDU_ID_1, TP_BS, value) == E_OK);
-    TEST_CHECK(CanTp_State.rxConnections[1].nsdu->bs == value);
+    TEST_CHECK(CanTp_State.rxNSdus[1].bs == value);
     
     // TEST 3 - invalid value
     test_nsdu = (CanTp_RxNSduType) {.id = PDU_ID_1, .paddingActivation = CANTP_OFF, .addressingFormat = CANTP_STANDARD, .STmin = 100};
     config.channels[0].rxNSdu[1] = test_nsdu;
-    CanTp_State.rxConnections[1].activation = CANTP_RX_WAIT;
+    CanTp_Init(&config);
     value = 567;
 
     TEST_CHECK(CanTp_ChangeParameter(PDU_ID_1, TP_STMIN, value) == E_NOT_OK);
-    TEST_CHECK(CanTp_State.rxConnections[1].nsdu->STmin == 100);
+    TEST_CHECK(CanTp_State.rxNSdus[1].stMin == 100);
 }
 
 
@@ -239,6 +385,7 @@ void TestOf_CanTp_ReadParameter(void){
     PduInfoType pdu = {.SduDataPtr = pduPayload, .MetaDataPtr = NULL, .SduLength = PDU_PAYLOAD_LEN_1,};
     CanTp_RxNSduType test_nsdu = {.id = PDU_ID_1, .paddingActivation = CANTP_OFF, .addressingFormat = CANTP_STANDARD, .bs = 100};
     config.channels[0].rxNSdu[1] = test_nsdu;
+    CanTp_Init(&config);
     uint16 readVal = 0;
     
     // TEST 1 - valid
@@ -257,6 +404,7 @@ void TestOf_CanTp_ReadParameter(void){
     // TEST 3 - invalid value
     test_nsdu = (CanTp_RxNSduType) {.id = PDU_ID_1, .paddingActivation = CANTP_OFF, .addressingFormat = CANTP_STANDARD, .STmin = 300};
     config.channels[0].rxNSdu[1] = test_nsdu;
+    CanTp_Init(&config);
     CanTp_State.rxConnections[1].aquiredBuffSize = 0;
     readVal = 0;
 
@@ -281,6 +429,7 @@ void TestOf_CanTp_RxIndication(void){
     PduInfoType pdu = {.SduDataPtr = pduPayload_1, .MetaDataPtr = NULL, .SduLength = PDU_PAYLOAD_LEN_1,};
     CanTp_RxNSduType test_nsdu = {.id = PDU_ID_1, .paddingActivation = CANTP_OFF, .addressingFormat = CANTP_STANDARD};
     config.channels[0].rxNSdu[1] = test_nsdu;
+    CanTp_Init(&config);
 
     CanTp_RxIndication(PDU_ID_1, &pdu);
 
@@ -302,6 +451,7 @@ void TestOf_CanTp_RxIndication(void){
     pdu = (PduInfoType) {.SduDataPtr = pduPayload_2, .MetaDataPtr = NULL, .SduLength = PDU_PAYLOAD_LEN_2,};
     test_nsdu = (CanTp_RxNSduType) {.id = PDU_ID_2, .paddingActivation = CANTP_OFF, .addressingFormat = CANTP_EXTENDED};
     config.channels[0].rxNSdu[1] = test_nsdu;
+    CanTp_Init(&config);
 
     CanTp_RxIndication(PDU_ID_2, &pdu);
 
@@ -314,15 +464,1531 @@ void TestOf_CanTp_RxIndication(void){
     TEST_CHECK(strcmp(testBuffer, "PSES") == 0);
     TEST_CHECK(PduR_CanTpCopyRxData_fake.arg0_val == PDU_ID_2);
 
-    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 3);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 2);
     TEST_CHECK(PduR_CanTpRxIndication_fake.arg0_val == PDU_ID_2);
     TEST_CHECK(PduR_CanTpRxIndication_fake.arg1_val == E_OK);
 }
 
 
+void TestOf_CanTp_PduIndex(void){
+    // TEST 1 - densely packed ids are addressed directly
+    CanTp_Init(&config);
+
+    TEST_CHECK(CanTp_State.rxIndex.direct == TRUE);
+    TEST_CHECK(CanTp_RxNSduLookup(101) == &CanTp_State.rxNSdus[0]);
+    TEST_CHECK(CanTp_RxNSduLookup(115) == &CanTp_State.rxNSdus[10]);
+    TEST_CHECK(CanTp_TxNSduLookup(212) == &CanTp_State.txNSdus[7]);
+    TEST_CHECK(CanTp_RxNSduLookup(100) == NULL);
+    TEST_CHECK(CanTp_RxNSduLookup(109) == NULL);
+    TEST_CHECK(CanTp_TxNSduLookup(101) == NULL);
+
+    // TEST 2 - sparse ids fall back to the hashed table
+    config.channels[1].rxNSdu[0].id = 40000;
+    config.channels[3].rxNSdu[2].id = 65000;
+    CanTp_Init(&config);
+
+    TEST_CHECK(CanTp_State.rxIndex.direct == FALSE);
+    TEST_CHECK(CanTp_RxNSduLookup(40000) == &CanTp_State.rxNSdus[5]);
+    TEST_CHECK(CanTp_RxNSduLookup(65000) == &CanTp_State.rxNSdus[10]);
+    TEST_CHECK(CanTp_RxNSduLookup(101) == &CanTp_State.rxNSdus[0]);
+    TEST_CHECK(CanTp_RxNSduLookup(106) == NULL);
+    TEST_CHECK(CanTp_RxNSduLookup(115) == NULL);
+}
+
+
+void TestOf_CanTp_ActiveConnections(void){
+    uint8 sdu[] = {1, 2, 3};
+    PduInfoType pduInfo = {.SduDataPtr = sdu, .SduLength = ARR_SIZE(sdu)};
+
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_CONFIRM_MOCK;
+    CanTp_Init(&config);
+    TEST_CHECK(CanTp_State.txActiveCount == 0);
+    TEST_CHECK(CanTp_State.rxActiveCount == 0);
+
+    // TEST 1 - claimed connections join the active set, idle ones are not visited
+    TEST_CHECK(CanTp_Transmit(206, &pduInfo) == E_OK);
+    TEST_CHECK(CanTp_Transmit(212, &pduInfo) == E_OK);
+    TEST_CHECK(CanTp_State.txActiveCount == 2);
+
+    CanTp_MainFunction();
+    TEST_CHECK(PduR_CanTpCopyTxData_fake.call_count == 2);
+
+    // TEST 2 - completed connections leave the active set
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 2);
+    TEST_CHECK(CanTp_State.txActiveCount == 0);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(txStateOf(212) == CANTP_TX_STATE_FREE);
+
+    // TEST 3 - removing a connection from the middle keeps the others reachable
+    CanTp_Transmit(201, &pduInfo);
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_Transmit(212, &pduInfo);
+    CanTp_CancelTransmit(201);
+    CanTp_MainFunction();
+    TEST_CHECK(CanTp_State.txActiveCount == 2);
+    TEST_CHECK(txStateOf(201) == CANTP_TX_STATE_FREE);
+    CanTp_MainFunction();
+    TEST_CHECK(CanTp_State.txActiveCount == 0);
+}
+
+
+void TestOf_CanTp_Timeouts(void){
+    uint8 data[] = {1,2,3,4,5,6,7,8,9,10};
+    PduInfoType pduInfo = {.SduDataPtr = data, .SduLength = ARR_SIZE(data)};
+    uint8 ffPayload[8] = {CANTP_N_PCI_TYPE_FF << 4, 20, 1, 2, 3, 4, 5, 6};
+    PduInfoType ff = {.SduDataPtr = ffPayload, .MetaDataPtr = NULL, .SduLength = 8};
+
+    RESET_FAKE(PduR_CanTpStartOfReception);
+    PduR_CanTpStartOfReception_fake.custom_fake = PduR_CanTpStartOfReception_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_CONFIRM_MOCK;
+    config.channels[1].txNSdu[0].nbs = 5;
+    config.channels[0].rxNSdu[0].nar = 2;
+    config.channels[0].rxNSdu[0].ncr = 3;
+    config.channels[1].txNSdu[2].nbs = 150;
+    CanTp_Init(&config);
+
+    // TEST 1 - N_Bs elapses while waiting for FC
+    TEST_CHECK(CanTp_Transmit(206, &pduInfo) == E_OK);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_FC);
+
+    // WAIT_FC was entered at time 1, N_Bs elapses in the period at time 6
+    for (int i = 0; i < 4; i++){
+        CanTp_MainFunction();
+    }
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_FC);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.call_count == 0);
+
+    CanTp_MainFunction();
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(getTxConnection(206) == NULL);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.call_count == 1);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.arg1_val == E_NOT_OK);
+    TEST_CHECK(Det_ReportRuntimeError_fake.arg3_val == CANTP_E_TX_COM);
+
+    // TEST 2 - N_Cr elapses 3 periods after the FC was confirmed
+    CanTp_RxIndication(101, &ff);
+    CanTp_MainFunction();
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_WAIT_CF);
+
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 0);
+    CanTp_MainFunction();
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 1);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.arg1_val == E_NOT_OK);
+    TEST_CHECK(Det_ReportRuntimeError_fake.arg3_val == CANTP_E_RX_COM);
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_ABORT);
+
+    // TEST 3 - timeouts longer than one turn of the wheel, unsupervised connections never time out
+    TEST_CHECK(CanTp_Transmit(207, &pduInfo) == E_OK);
+    TEST_CHECK(CanTp_Transmit(208, &pduInfo) == E_OK);
+    for (int i = 0; i < 151; i++){
+        CanTp_MainFunction();
+    }
+    TEST_CHECK(txStateOf(208) == CANTP_TX_STATE_WAIT_FC);
+    CanTp_MainFunction();
+    TEST_CHECK(txStateOf(208) == CANTP_TX_STATE_FREE);
+
+    for (int i = 0; i < 200; i++){
+        CanTp_MainFunction();
+    }
+    TEST_CHECK(txStateOf(207) == CANTP_TX_STATE_WAIT_FC);
+
+    // TEST 4 - N_Ar elapses while CanIf does not confirm the FC
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_MOCK;
+    CanTp_RxIndication(101, &ff);
+    CanTp_MainFunction();
+    TEST_CHECK(canIfFrames[CanIf_Transmit_fake.call_count - 1][0] == ((CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_CTS));
+    CanTp_MainFunction();
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 1);
+    CanTp_MainFunction();
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 2);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.arg1_val == E_NOT_OK);
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_ABORT);
+    CanTp_MainFunction();
+
+    // TEST 5 - N_Cr starts when the FC is confirmed, not when it is handed to CanIf
+    CanTp_RxIndication(101, &ff);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    CanTp_TxConfirmation(101, E_OK);
+    for (int i = 0; i < 3; i++){
+        CanTp_MainFunction();
+    }
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_WAIT_CF);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 2);
+    CanTp_MainFunction();
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 3);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.arg1_val == E_NOT_OK);
+}
+
+
+void TestOf_CanTp_ImmediateDispatch(void){
+    uint8 data[10] = {0};
+    PduInfoType pduInfo = {.SduDataPtr = data, .SduLength = ARR_SIZE(data)};
+    uint8 fcPayload[3] = {CANTP_N_PCI_TYPE_FC << 4, 0, 0};
+    PduInfoType fc = {.SduDataPtr = fcPayload, .MetaDataPtr = NULL, .SduLength = 3};
+    uint8 ffPayload[8] = {CANTP_N_PCI_TYPE_FF << 4, 20, 1, 2, 3, 4, 5, 6};
+    PduInfoType ff = {.SduDataPtr = ffPayload, .MetaDataPtr = NULL, .SduLength = 8};
+
+    PduR_CanTpStartOfReception_fake.custom_fake = PduR_CanTpStartOfReception_MOCK;
+    PduR_CanTpCopyTxData_fake.custom_fake = PduR_CanTpCopyTxData_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_CONFIRM_MOCK;
+    config.channels[0].immediateDispatch = TRUE;
+    config.channels[1].immediateDispatch = TRUE;
+    config.channels[0].rxNSdu[0].bs = 2;
+    config.channels[0].rxNSdu[0].STmin = 5;
+    CanTp_Init(&config);
+
+    // TEST 1 - CF goes out from the FC reception
+    txDataLeft = ARR_SIZE(data);
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_FC);
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 1);
+
+    CanTp_RxIndication(206, &fc);
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 2);
+    TEST_CHECK(canIfFrames[1][0] == ((CANTP_N_PCI_TYPE_CF << 4) | 1));
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.arg1_val == E_OK);
+
+    // TEST 2 - FC goes out from the FF reception
+    CanTp_RxIndication(101, &ff);
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 3);
+    TEST_CHECK(canIfFrameLen[2] == CAN_2_0_MAX_LEN);
+    TEST_CHECK(canIfFrames[2][0] == ((CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_CTS));
+    TEST_CHECK(canIfFrames[2][1] == 2);
+    TEST_CHECK(canIfFrames[2][2] == 5);
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_WAIT_CF);
+
+    // TEST 3 - CFs following the first one wait for STmin
+    uint8 longData[20] = {0};
+    pduInfo = (PduInfoType){.SduDataPtr = longData, .SduLength = ARR_SIZE(longData)};
+    txDataLeft = ARR_SIZE(longData);
+    fcPayload[2] = 10;
+    CanTp_Transmit(207, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    CanTp_RxIndication(207, &fc);
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 5);
+    CanTp_TxConfirmation(207, E_OK);
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 5);
+    TEST_CHECK(txStateOf(207) == CANTP_TX_STATE_CF_SEND_REQ);
+
+    // TEST 4 - CanIf confirming within CanIf_Transmit, the CFs of a long SDU don't nest
+    static uint8 sdu[100000];
+    pduInfo = (PduInfoType){.SduDataPtr = sdu, .SduLength = ARR_SIZE(sdu)};
+    txDataLeft = ARR_SIZE(sdu);
+    fcPayload[2] = 0;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_DEPTH_MOCK;
+    uint32 sent = CanIf_Transmit_fake.call_count;
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    CanTp_RxIndication(206, &fc);
+    // FF with the FF_DL escape (2 bytes) and 14286 CFs
+    TEST_CHECK(CanIf_Transmit_fake.call_count == sent + 14287);
+    TEST_CHECK(canIfDepthMax == 1);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.arg1_val == E_OK);
+}
+
+
+void TestOf_CanTp_CfBurst(void){
+    uint8 data[40] = {0};
+    PduInfoType pduInfo = {.SduDataPtr = data, .SduLength = ARR_SIZE(data)};
+    uint8 fcPayload[3] = {CANTP_N_PCI_TYPE_FC << 4, 0, 0};
+    PduInfoType fc = {.SduDataPtr = fcPayload, .MetaDataPtr = NULL, .SduLength = 3};
+
+    PduR_CanTpCopyTxData_fake.custom_fake = PduR_CanTpCopyTxData_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_CONFIRM_MOCK;
+    config.channels[1].maxCfPerTick = 3;
+    CanTp_Init(&config);
+
+    // TEST 1 - STmin = 0, the channel budget limits the CFs per period (FF + 5 CFs for 40 bytes)
+    txDataLeft = ARR_SIZE(data);
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    CanTp_RxIndication(206, &fc);
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 1);
+
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 4);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 6);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.arg1_val == E_OK);
+
+    // TEST 2 - STmin = 2 ms, one CF every second period regardless of the budget
+    txDataLeft = ARR_SIZE(data);
+    fcPayload[2] = 2;
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    CanTp_RxIndication(206, &fc);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 8);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 8);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 9);
+    for (int i = 0; i < 10; i++){
+        CanTp_MainFunction();
+    }
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+
+    // TEST 3 - STmin in the 100 us range allows one CF per period
+    txDataLeft = ARR_SIZE(data);
+    fcPayload[2] = 0xF5;
+    CanTp_Transmit(207, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    CanTp_RxIndication(207, &fc);
+    uint32 sent = CanIf_Transmit_fake.call_count;
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == sent + 2);
+    TEST_CHECK(txStateOf(207) == CANTP_TX_STATE_CF_SEND_REQ);
+    TEST_CHECK(CanTp_StMinToPeriods(0xF5) == 1);
+    TEST_CHECK(CanTp_StMinToPeriods(0x80) == 127);
+
+    // TEST 4 - CanIf confirming after CanIf_Transmit returned, the burst stops at each unconfirmed CF
+    CanTp_Init(&config);
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_MOCK;
+    txDataLeft = ARR_SIZE(data);
+    fcPayload[2] = 0;
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    CanTp_TxConfirmation(CanIf_Transmit_fake.arg0_val, E_OK);
+    CanTp_RxIndication(206, &fc);
+    sent = CanIf_Transmit_fake.call_count;
+
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == sent + 1);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_CANIF_CONFIRM);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == sent + 1);
+    CanTp_TxConfirmation(CanIf_Transmit_fake.arg0_val, E_OK);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == sent + 2);
+    for (int i = 0; i < 3; i++){
+        CanTp_TxConfirmation(CanIf_Transmit_fake.arg0_val, E_OK);
+        CanTp_MainFunction();
+    }
+    TEST_CHECK(CanIf_Transmit_fake.call_count == sent + 5);
+    CanTp_TxConfirmation(CanIf_Transmit_fake.arg0_val, E_OK);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.arg1_val == E_OK);
+}
+
+
+void TestOf_CanTp_Framing(void){
+    uint8 pciSize = 0;
+    uint8 data[5000] = {0};
+    PduInfoType pduInfo = {.SduDataPtr = data, .SduLength = ARR_SIZE(data)};
+
+    // TEST 1 - classic and escaped SF_DL
+    uint8 sf[] = {CANTP_N_PCI_TYPE_SF << 4 | 3, 1, 2, 3};
+    TEST_CHECK(CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_SF, sf, ARR_SIZE(sf), 0, &pciSize) == 3);
+    TEST_CHECK(pciSize == CANTP_SF_PCI_SIZE);
+    uint8 sfEsc[12] = {CANTP_N_PCI_TYPE_SF << 4, 10};
+    TEST_CHECK(CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_SF, sfEsc, ARR_SIZE(sfEsc), 0, &pciSize) == 10);
+    TEST_CHECK(pciSize == CANTP_SF_ESC_PCI_SIZE);
+    // SF_DL longer than the frame is invalid
+    sfEsc[1] = 11;
+    TEST_CHECK(CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_SF, sfEsc, ARR_SIZE(sfEsc), 0, &pciSize) == 0);
+    // No escape sequence in frames up to 8 bytes
+    sfEsc[1] = 5;
+    TEST_CHECK(CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_SF, sfEsc, 8, 0, &pciSize) == 0);
+    TEST_CHECK(CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_SF, sfEsc, 7, 1, &pciSize) == 0);
+    // Escaped SF_DL which fits the N_PCI byte of an 8 byte frame (7 bytes, 6 with an address byte)
+    sfEsc[1] = 7;
+    TEST_CHECK(CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_SF, sfEsc, ARR_SIZE(sfEsc), 0, &pciSize) == 0);
+    TEST_CHECK(CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_SF, sfEsc, ARR_SIZE(sfEsc), 1, &pciSize) == 7);
+    sfEsc[1] = 6;
+    TEST_CHECK(CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_SF, sfEsc, ARR_SIZE(sfEsc) - 1, 1, &pciSize) == 0);
+    sfEsc[1] = 8;
+    TEST_CHECK(CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_SF, sfEsc, ARR_SIZE(sfEsc), 0, &pciSize) == 8);
+
+    // Escaped SFs received in a classic frame or with a short SF_DL never reach PduR
+    uint8 sfRx[12] = {CANTP_N_PCI_TYPE_SF << 4, 5, 1, 2, 3, 4, 5};
+    PduInfoType sfPdu = {.SduDataPtr = sfRx, .MetaDataPtr = NULL, .SduLength = 8};
+    CanTp_Init(&config);
+    CanTp_RxIndication(101, &sfPdu);
+    sfRx[1] = 7;
+    sfPdu.SduLength = ARR_SIZE(sfRx);
+    CanTp_RxIndication(101, &sfPdu);
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.call_count == 0);
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_FREE);
+
+    // TEST 2 - 12 bit and escaped FF_DL
+    uint8 ff[] = {CANTP_N_PCI_TYPE_FF << 4 | 0x01, 0x23, 0, 0, 0, 0};
+    TEST_CHECK(CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_FF, ff, ARR_SIZE(ff), 0, &pciSize) == 0x123);
+    TEST_CHECK(pciSize == CANTP_FF_PCI_SIZE);
+    uint8 ffEsc[] = {CANTP_N_PCI_TYPE_FF << 4, 0, 0x00, 0x01, 0x00, 0x00};
+    TEST_CHECK(CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_FF, ffEsc, ARR_SIZE(ffEsc), 0, &pciSize) == 0x10000);
+    TEST_CHECK(pciSize == CANTP_FF_ESC_PCI_SIZE);
+
+    // TEST 3 - message longer than 4095 bytes is sent with the FF_DL escape sequence
+    PduR_CanTpCopyTxData_fake.custom_fake = PduR_CanTpCopyTxData_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_CONFIRM_MOCK;
+    CanTp_Init(&config);
+    txDataLeft = ARR_SIZE(data);
+
+    TEST_CHECK(CanTp_Transmit(206, &pduInfo) == E_OK);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 1);
+    TEST_CHECK(canIfFrameLen[0] == CAN_2_0_MAX_LEN);
+    TEST_CHECK(canIfFrames[0][0] == (CANTP_N_PCI_TYPE_FF << 4));
+    TEST_CHECK(canIfFrames[0][1] == 0);
+    TEST_CHECK(canIfFrames[0][4] == 0x13);
+    TEST_CHECK(canIfFrames[0][5] == 0x88);
+
+    // TEST 4 - FF_DL that fits into a SF is ignored
+    uint8 ffShort[] = {CANTP_N_PCI_TYPE_FF << 4, 5, 1, 2, 3, 4, 5, 0};
+    PduInfoType pdu = {.SduDataPtr = ffShort, .MetaDataPtr = NULL, .SduLength = ARR_SIZE(ffShort)};
+    CanTp_RxIndication(101, &pdu);
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.call_count == 0);
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_FREE);
+}
+
+
+void TestOf_CanTp_FrameLength(void){
+    uint8 data[40] = {0};
+    PduInfoType pduInfo = {.SduDataPtr = data, .SduLength = ARR_SIZE(data)};
+
+    PduR_CanTpCopyTxData_fake.custom_fake = PduR_CanTpCopyTxData_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_CONFIRM_MOCK;
+    PduR_CanTpStartOfReception_fake.custom_fake = PduR_CanTpStartOfReception_MOCK;
+    PduR_CanTpCopyRxData_fake.custom_fake = PduR_CanTpCopyRxData_MOCK;
+    config.channels[1].txNSdu[1].maxFrameLen = CAN_FD_MAX_LEN;
+    config.channels[0].rxNSdu[0].maxFrameLen = CAN_FD_MAX_LEN;
+    CanTp_Init(&config);
+
+    // TEST 1 - frame buffers of the connections are sized for the longest frame and do not overlap
+    TEST_CHECK(CanTp_State.txConnections[1].buf.data == CanTp_State.txConnections[0].buf.data + CAN_FD_MAX_LEN);
+    TEST_CHECK(CanTp_State.rxConnections[0].fcBuf.data == CanTp_State.txConnections[CANTP_TX_CONNECTIONS_COUNT - 1].buf.data + CAN_FD_MAX_LEN);
+
+    // TEST 2 - the same message is a SF on the CAN FD NSdu and a segmented transfer on the classic one
+    txDataLeft = ARR_SIZE(data);
+    TEST_CHECK(CanTp_Transmit(207, &pduInfo) == E_OK);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 1);
+    // 42 bytes are sent in the 48 byte DLC
+    TEST_CHECK(canIfFrameLen[0] == 48);
+    TEST_CHECK(canIfFrames[0][ARR_SIZE(data) + CANTP_SF_ESC_PCI_SIZE] == CONFIG_CANTP_PADDING_BYTE);
+    TEST_CHECK(canIfFrames[0][0] == (CANTP_N_PCI_TYPE_SF << 4));
+    TEST_CHECK(canIfFrames[0][1] == ARR_SIZE(data));
+    TEST_CHECK(txStateOf(207) == CANTP_TX_STATE_FREE);
+
+    txDataLeft = ARR_SIZE(data);
+    TEST_CHECK(CanTp_Transmit(206, &pduInfo) == E_OK);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(canIfFrameLen[1] == CAN_2_0_MAX_LEN);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_FC);
+
+    // TEST 3 - escaped SF received on the CAN FD NSdu
+    uint8 sf[24] = {CANTP_N_PCI_TYPE_SF << 4, 20};
+    PduInfoType pdu = {.SduDataPtr = sf, .MetaDataPtr = NULL, .SduLength = ARR_SIZE(sf)};
+    CanTp_RxIndication(101, &pdu);
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.arg2_val == 20);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.arg1_val == E_OK);
+}
+
+
+void TestOf_CanTp_ZeroCopy(void){
+    uint8 data[20];
+    PduInfoType pduInfo = {.SduDataPtr = data, .SduLength = ARR_SIZE(data)};
+    uint8 fcPayload[3] = {CANTP_N_PCI_TYPE_FC << 4, 0, 0};
+    PduInfoType fc = {.SduDataPtr = fcPayload, .MetaDataPtr = NULL, .SduLength = 3};
+
+    for (uint8 i = 0; i < ARR_SIZE(data); i++){
+        data[i] = i;
+    }
+    CanIf_TransmitGather_fake.custom_fake = CanIf_TransmitGather_MOCK;
+    config.channels[1].txNSdu[0].zeroCopy = TRUE;
+    config.channels[1].maxCfPerTick = 4;
+    CanTp_Init(&config);
+
+    // TEST 1 - FF and CFs are gathered from the SDU, PduR is not asked for a copy
+    TEST_CHECK(CanTp_Transmit(206, &pduInfo) == E_OK);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    CanTp_RxIndication(206, &fc);
+    CanTp_MainFunction();
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.arg1_val == E_OK);
+    TEST_CHECK(PduR_CanTpCopyTxData_fake.call_count == 0);
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 0);
+    TEST_CHECK(CanIf_TransmitGather_fake.call_count == 3);
+
+    TEST_CHECK(canIfFrameLen[0] == CAN_2_0_MAX_LEN);
+    TEST_CHECK(canIfFrames[0][1] == ARR_SIZE(data));
+    TEST_CHECK(canIfFrames[0][2] == 0 && canIfFrames[0][7] == 5);
+    TEST_CHECK(canIfFrames[1][0] == ((CANTP_N_PCI_TYPE_CF << 4) | 1));
+    TEST_CHECK(canIfFrames[1][1] == 6 && canIfFrames[1][7] == 12);
+    TEST_CHECK(canIfFrameLen[2] == CAN_2_0_MAX_LEN);
+    TEST_CHECK(canIfFrames[2][1] == 13 && canIfFrames[2][7] == 19);
+
+    // TEST 2 - NSdus without zeroCopy keep copying through PduR
+    PduR_CanTpCopyTxData_fake.custom_fake = PduR_CanTpCopyTxData_MOCK;
+    txDataLeft = 3;
+    pduInfo.SduLength = 3;
+    TEST_CHECK(CanTp_Transmit(207, &pduInfo) == E_OK);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(PduR_CanTpCopyTxData_fake.call_count == 1);
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 1);
+}
+
+
+void TestOf_CanTp_TxStaging(void){
+    uint8 data[40] = {0};
+    PduInfoType pduInfo = {.SduDataPtr = data, .SduLength = ARR_SIZE(data)};
+    uint8 fcPayload[3] = {CANTP_N_PCI_TYPE_FC << 4, 0, 0};
+    PduInfoType fc = {.SduDataPtr = fcPayload, .MetaDataPtr = NULL, .SduLength = 3};
+
+    PduR_CanTpCopyTxData_fake.custom_fake = PduR_CanTpCopyTxData_SEQ_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_CONFIRM_MOCK;
+    config.channels[1].txNSdu[0].txStagingSize = 64;
+    config.channels[1].maxCfPerTick = 8;
+    CanTp_Init(&config);
+
+    // TEST 1 - BS = 0, all CFs (34 bytes) are fetched by a single call after the FF
+    txDataLeft = ARR_SIZE(data);
+    txDataNext = 0;
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    CanTp_RxIndication(206, &fc);
+    CanTp_MainFunction();
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 6);
+    TEST_CHECK(PduR_CanTpCopyTxData_fake.call_count == 2);
+    for (uint8 cfItr = 1; cfItr < 6; cfItr++){
+        TEST_CHECK(canIfFrames[cfItr][1] == (6 + ((cfItr - 1) * 7)));
+    }
+    TEST_CHECK(canIfFrameLen[5] == CAN_2_0_MAX_LEN);
+    TEST_CHECK(canIfFrames[5][6] == 39);
+
+    // TEST 2 - BS = 2, data is fetched one block (2 CFs) at a time
+    txDataLeft = ARR_SIZE(data);
+    txDataNext = 0;
+    fcPayload[1] = 2;
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    for (uint8 blockItr = 0; blockItr < 3; blockItr++){
+        TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_FC);
+        CanTp_RxIndication(206, &fc);
+        CanTp_MainFunction();
+    }
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpCopyTxData_fake.call_count == 2 + 4);
+    TEST_CHECK(canIfFrames[11][6] == 39);
+}
+
+
+void TestOf_CanTp_RxReassembly(void){
+    uint8 ff[8] = {CANTP_N_PCI_TYPE_FF << 4, 40, 0, 1, 2, 3, 4, 5};
+    uint8 cf[8];
+    PduInfoType pdu = {.SduDataPtr = ff, .MetaDataPtr = NULL, .SduLength = 8};
+
+    PduR_CanTpStartOfReception_fake.custom_fake = PduR_CanTpStartOfReception_MOCK;
+    PduR_CanTpCopyRxData_fake.custom_fake = PduR_CanTpCopyRxData_MOCK;
+    config.channels[0].rxNSdu[0].rxReassemblySize = 32;
+    config.channels[0].rxNSdu[0].bs = 3;
+    CanTp_Init(&config);
+
+    CanTp_RxIndication(101, &pdu);
+    CanTp_MainFunction();
+    TEST_CHECK(PduR_CanTpCopyRxData_fake.call_count == 1);
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_WAIT_CF);
+
+    // TEST 1 - CFs of a block are collected and handed over together when the block ends
+    pdu.SduDataPtr = cf;
+    for (uint8 cfItr = 0; cfItr < 5; cfItr++){
+        cf[0] = (CANTP_N_PCI_TYPE_CF << 4) | (cfItr + 1);
+        for (uint8 byteItr = 1; byteItr < 8; byteItr++){
+            cf[byteItr] = 6 + (cfItr * 7) + (byteItr - 1);
+        }
+        CanTp_RxIndication(101, &pdu);
+
+        if (cfItr < 2){
+            TEST_CHECK(PduR_CanTpCopyRxData_fake.call_count == 1);
+        }
+        else if (cfItr == 2){
+            TEST_CHECK(PduR_CanTpCopyRxData_fake.call_count == 2);
+            TEST_CHECK(testBuffer[0] == 6 && testBuffer[20] == 26);
+            TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_FC_TX_REQ);
+            CanTp_MainFunction();
+        }
+    }
+
+    // TEST 2 - the rest of the message is flushed with the last CF, padding is dropped
+    TEST_CHECK(PduR_CanTpCopyRxData_fake.call_count == 3);
+    TEST_CHECK(testBuffer[0] == 27 && testBuffer[12] == 39);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 1);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.arg1_val == E_OK);
+}
+
+
+void TestOf_CanTp_TxConfirmation(void){
+    uint8 data[10] = {0};
+    PduInfoType pduInfo = {.SduDataPtr = data, .SduLength = 3};
+    uint8 fcPayload[3] = {CANTP_N_PCI_TYPE_FC << 4, 0, 0};
+    PduInfoType fc = {.SduDataPtr = fcPayload, .MetaDataPtr = NULL, .SduLength = 3};
+
+    PduR_CanTpCopyTxData_fake.custom_fake = PduR_CanTpCopyTxData_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_MOCK;
+    config.channels[1].txNSdu[0].nas = 3;
+    config.channels[1].immediateDispatch = TRUE;
+    CanTp_Init(&config);
+
+    // TEST 1 - SF is reported to PduR only after CanIf confirmed it
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 1);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_CANIF_CONFIRM);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.call_count == 0);
+
+    CanTp_TxConfirmation(206, E_OK);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.call_count == 1);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.arg1_val == E_OK);
+
+    // TEST 2 - FF confirmation starts N_Bs, each CF confirmation sends the next CF
+    txDataLeft = ARR_SIZE(data);
+    pduInfo.SduLength = ARR_SIZE(data);
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    CanTp_TxConfirmation(206, E_OK);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_FC);
+    CanTp_RxIndication(206, &fc);
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 3);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_CANIF_CONFIRM);
+    CanTp_TxConfirmation(206, E_OK);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.call_count == 2);
+
+    // TEST 3 - missing confirmation aborts the transmission after N_As
+    pduInfo.SduLength = 3;
+    CanTp_Transmit(206, &pduInfo);
+    for (int i = 0; i < 4; i++){
+        CanTp_MainFunction();
+    }
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.arg1_val == E_NOT_OK);
+    TEST_CHECK(Det_ReportRuntimeError_fake.arg3_val == CANTP_E_TX_COM);
+    CanTp_TxConfirmation(206, E_OK);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.call_count == 3);
+}
+
+
+void TestOf_CanTp_ConnectionPool(void){
+    uint8 ff[8] = {CANTP_N_PCI_TYPE_FF << 4, 20, 0, 1, 2, 3, 4, 5};
+    uint8 cf[8] = {(CANTP_N_PCI_TYPE_CF << 4) | 1, 6, 7, 8, 9, 10, 11, 12};
+    PduInfoType pdu = {.SduDataPtr = ff, .MetaDataPtr = NULL, .SduLength = 8};
+    uint8 sdu[] = {1, 2, 3};
+    PduInfoType pduInfo = {.SduDataPtr = sdu, .SduLength = ARR_SIZE(sdu)};
+    const PduIdType rxIds[] = {101, 102, 103, 104};
+    const PduIdType txIds[] = {201, 206, 207, 208};
+    CanTp_PoolStatsType rxStats;
+    CanTp_PoolStatsType txStats;
+
+    PduR_CanTpStartOfReception_fake.custom_fake = PduR_CanTpStartOfReception_MOCK;
+    CanTp_Init(&config);
+    CanTp_GetPoolStats(&rxStats, &txStats);
+    TEST_CHECK(rxStats.size == 4 && rxStats.inUse == 0);
+    TEST_CHECK(txStats.size == 4 && txStats.inUse == 0);
+
+    // TEST 1 - receptions bind connections from the pool only while they are in progress
+    for (uint32 idItr = 0; idItr < ARR_SIZE(rxIds); idItr++){
+        CanTp_RxIndication(rxIds[idItr], &pdu);
+        CanTp_MainFunction();
+        TEST_CHECK(rxStateOf(rxIds[idItr]) == CANTP_RX_STATE_WAIT_CF);
+    }
+    TEST_CHECK(getRxConnection(105) == NULL);
+    CanTp_GetPoolStats(&rxStats, NULL);
+    TEST_CHECK(rxStats.inUse == 4 && rxStats.peakInUse == 4);
+
+    // TEST 2 - a new reception on an exhausted pool evicts the oldest one
+    CanTp_RxIndication(105, &pdu);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 1);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.arg0_val == 101);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.arg1_val == E_NOT_OK);
+    TEST_CHECK(getRxConnection(101) == NULL);
+    TEST_CHECK(rxStateOf(105) == CANTP_RX_STATE_FC_TX_REQ);
+    CanTp_GetPoolStats(&rxStats, NULL);
+    TEST_CHECK(rxStats.inUse == 4 && rxStats.exhaustedCount == 1 && rxStats.evictedCount == 1);
+
+    // TEST 3 - a CF does not bind a connection
+    pdu.SduDataPtr = cf;
+    CanTp_RxIndication(101, &pdu);
+    TEST_CHECK(getRxConnection(101) == NULL);
+
+    // TEST 4 - Transmit is rejected when no tx connection is free
+    for (uint32 idItr = 0; idItr < ARR_SIZE(txIds); idItr++){
+        TEST_CHECK(CanTp_Transmit(txIds[idItr], &pduInfo) == E_OK);
+    }
+    TEST_CHECK(CanTp_Transmit(209, &pduInfo) == E_NOT_OK);
+    TEST_CHECK(getTxConnection(209) == NULL);
+    CanTp_GetPoolStats(NULL, &txStats);
+    TEST_CHECK(txStats.inUse == 4 && txStats.exhaustedCount == 1);
+}
+
+void TestOf_CanTp_Config(void){
+    static const CanTp_ConfigType romConfig = {
+        .channels = {
+            {.rxNSdu = {{.id = 500, .bs = 4, .STmin = 10}}, .rxNSduCount = 1, .txNSdu = {{.id = 600}}, .txNSduCount = 1},
+        }
+    };
+    uint16 value = 0;
+
+    // TEST 1 - the configuration passed to CanTp_Init replaces the default one
+    CanTp_Init(&romConfig);
+    TEST_CHECK(CanTp_RxNSduLookup(500)->nsdu == &romConfig.channels[0].rxNSdu[0]);
+    TEST_CHECK(CanTp_TxNSduLookup(600)->channel == &romConfig.channels[0]);
+    TEST_CHECK(CanTp_RxNSduLookup(101) == NULL);
+    TEST_CHECK(CanTp_TxNSduLookup(201) == NULL);
+
+    // TEST 2 - changed parameters are kept outside of the configuration
+    TEST_CHECK(CanTp_ChangeParameter(500, TP_BS, 7) == E_OK);
+    TEST_CHECK(CanTp_ReadParameter(500, TP_BS, &value) == E_OK);
+    TEST_CHECK(value == 7);
+    TEST_CHECK(romConfig.channels[0].rxNSdu[0].bs == 4);
+
+    // TEST 3 - CanTp_Init restores the configured values
+    CanTp_Init(&romConfig);
+    TEST_CHECK(CanTp_ReadParameter(500, TP_BS, &value) == E_OK);
+    TEST_CHECK(value == 4);
+
+    // TEST 4 - without a configuration the default one is used
+    CanTp_Init(NULL);
+    TEST_CHECK(CanTp_RxNSduLookup(101)->nsdu == &CanTp_DefaultConfig.channels[0].rxNSdu[0]);
+    TEST_CHECK(CanTp_RxNSduLookup(500) == NULL);
+}
+
+void TestOf_CanTp_FrameLayout(void){
+    config.channels[0].rxNSdu[0].addressingFormat = CANTP_EXTENDED;
+    config.channels[0].rxNSdu[0].maxFrameLen = CAN_FD_MAX_LEN;
+    config.channels[0].rxNSdu[1].paddingActivation = CANTP_OFF;
+    CanTp_Init(&config);
+
+    // TEST 1 - classic frame, normal addressing
+    CanTp_FrameLayout txLayout = CanTp_TxLayoutOf(CanTp_TxNSduLookup(201)->nsdu);
+    const CanTp_FrameLayout *layout = &txLayout;
+    TEST_CHECK(layout->frameLen == 8 && layout->nAe == 0);
+    TEST_CHECK(layout->sfPayload == 7 && layout->cfPayload == 7);
+    TEST_CHECK(layout->padLen == 8 && layout->fcLen == 3);
+
+    // TEST 2 - CAN FD frame with the extended address byte
+    CanTp_FrameLayout rxLayout = CanTp_RxLayoutOf(CanTp_RxNSduLookup(101)->nsdu);
+    layout = &rxLayout;
+    TEST_CHECK(layout->frameLen == CAN_FD_MAX_LEN && layout->nAe == 1);
+    TEST_CHECK(layout->sfPayload == CAN_FD_MAX_LEN - CANTP_SF_ESC_PCI_SIZE - 1);
+    TEST_CHECK(layout->cfPayload == CAN_FD_MAX_LEN - CANTP_CF_PCI_SIZE - 1);
+    TEST_CHECK(layout->fcLen == 4);
+
+    // TEST 3 - without padding short frames are accepted
+    TEST_CHECK(CanTp_RxLayoutOf(CanTp_RxNSduLookup(102)->nsdu).padLen == 0);
+}
+
+void TestOf_CanTp_FlowControl(void){
+    uint8 data[40] = {0};
+    PduInfoType pduInfo = {.SduDataPtr = data, .SduLength = ARR_SIZE(data)};
+    uint8 fcPayload[3] = {CANTP_N_PCI_TYPE_FC << 4, 2, 0};
+    PduInfoType fc = {.SduDataPtr = fcPayload, .MetaDataPtr = NULL, .SduLength = 3};
+
+    PduR_CanTpCopyTxData_fake.custom_fake = PduR_CanTpCopyTxData_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_CONFIRM_MOCK;
+    config.channels[1].txNSdu[0].nbs = 5;
+    config.channels[1].maxCfPerTick = 8;
+    CanTp_Init(&config);
+
+    // TEST 1 - CTS with BS = 2, the sender stops after each block
+    txDataLeft = ARR_SIZE(data);
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    CanTp_RxIndication(206, &fc);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 1 + 2);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_FC);
+
+    // TEST 2 - FC.WAIT restarts N_Bs
+    fcPayload[0] = (CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_WT;
+    for (uint8 waitItr = 0; waitItr < 3; waitItr++){
+        for (uint8 tickItr = 0; tickItr < 3; tickItr++){
+            CanTp_MainFunction();
+        }
+        CanTp_RxIndication(206, &fc);
+    }
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_FC);
+    TEST_CHECK(Det_ReportRuntimeError_fake.call_count == 0);
+
+    // TEST 3 - CTS with BS = 0 and STmin = 2 ms, the rest is sent paced by STmin
+    fcPayload[0] = (CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_CTS;
+    fcPayload[1] = 0;
+    fcPayload[2] = 2;
+    CanTp_RxIndication(206, &fc);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 4);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 4);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 5);
+    for (uint8 tickItr = 0; tickItr < 4; tickItr++){
+        CanTp_MainFunction();
+    }
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 6);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.arg1_val == E_OK);
+
+    // TEST 4 - FC.OVFLW aborts the transmission
+    txDataLeft = ARR_SIZE(data);
+    fcPayload[0] = (CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_OVF;
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    CanTp_RxIndication(206, &fc);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.call_count == 2);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.arg1_val == E_NOT_OK);
+}
+
 /*
   Lista testów
 */
+void TestOf_CanTp_AdaptiveBlockSize(void){
+    uint8 ff[8] = {CANTP_N_PCI_TYPE_FF << 4, 100, 0, 1, 2, 3, 4, 5};
+    uint8 cf[8] = {0};
+    PduInfoType pdu = {.SduDataPtr = ff, .MetaDataPtr = NULL, .SduLength = 8};
+
+    PduR_CanTpStartOfReception_fake.custom_fake = PduR_CanTpStartOfReception_BUFFER_MOCK;
+    PduR_CanTpCopyRxData_fake.custom_fake = PduR_CanTpCopyRxData_BUFFER_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_MOCK;
+    config.channels[0].rxNSdu[0].bs = 8;
+    config.channels[0].rxNSdu[0].adaptiveBs = TRUE;
+    config.channels[0].rxNSdu[0].wftMax = 5;
+    CanTp_Init(&config);
+
+    // TEST 1 - 14 bytes are left after the FF payload, the block is cut to 2 CFs
+    rxBufferLeft = 20;
+    CanTp_RxIndication(101, &pdu);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 1);
+    TEST_CHECK(canIfFrames[0][0] == ((CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_CTS));
+    TEST_CHECK(canIfFrames[0][1] == 2);
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_WAIT_CF);
+
+    // TEST 2 - buffer exhausted by the block, FC.WAIT is repeated until PduR has room again
+    pdu.SduDataPtr = cf;
+    for (uint8 cfItr = 1; cfItr <= 2; cfItr++){
+        cf[0] = (CANTP_N_PCI_TYPE_CF << 4) | cfItr;
+        CanTp_RxIndication(101, &pdu);
+    }
+    TEST_CHECK(rxBufferLeft == 0);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 3);
+    TEST_CHECK(canIfFrames[1][0] == ((CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_WT));
+    TEST_CHECK(canIfFrames[2][0] == ((CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_WT));
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_FC_TX_REQ);
+
+    // TEST 3 - the 80 bytes left fit, the block is limited by the configured BS
+    rxBufferLeft = 100;
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 4);
+    TEST_CHECK(canIfFrames[3][0] == ((CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_CTS));
+    TEST_CHECK(canIfFrames[3][1] == 8);
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_WAIT_CF);
+}
+
+void TestOf_CanTp_FlowControlWait(void){
+    uint8 ff[8] = {CANTP_N_PCI_TYPE_FF << 4, 100, 0, 1, 2, 3, 4, 5};
+    PduInfoType pdu = {.SduDataPtr = ff, .MetaDataPtr = NULL, .SduLength = 8};
+
+    PduR_CanTpStartOfReception_fake.custom_fake = PduR_CanTpStartOfReception_BUSY_MOCK;
+    PduR_CanTpCopyRxData_fake.custom_fake = PduR_CanTpCopyRxData_BUFFER_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_MOCK;
+    config.channels[0].rxNSdu[0].wftMax = 2;
+    config.channels[0].rxNSdu[0].nbr = 3;
+    CanTp_Init(&config);
+
+    // TEST 1 - busy PduR is answered with FC.WAIT, the start is retried when N_Br elapses
+    rxBufferLeft = 200;
+    rxStartBusyCount = 2;
+    CanTp_RxIndication(101, &pdu);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 1);
+    TEST_CHECK(canIfFrames[0][0] == ((CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_WT));
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_WAIT_BUFFER);
+    TEST_CHECK(PduR_CanTpCopyRxData_fake.call_count == 0);
+
+    for (int i = 0; i < 3; i++){
+        CanTp_MainFunction();
+    }
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 1);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 2);
+    TEST_CHECK(canIfFrames[1][0] == ((CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_CTS));
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.call_count == 3);
+    // The FF payload was kept, not read again from the frame
+    TEST_CHECK(PduR_CanTpCopyRxData_fake.call_count == 1);
+    TEST_CHECK(PduR_CanTpCopyRxData_fake.arg1_history[0]->SduLength == 6);
+    TEST_CHECK(rxBufferLeft == 194);
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_WAIT_CF);
+
+    // TEST 2 - the reception is given up when wftMax FC.WAIT did not help
+    CanTp_Init(&config);
+    rxStartBusyCount = 10;
+    CanTp_RxIndication(101, &pdu);
+    for (int i = 0; i < 10; i++){
+        CanTp_MainFunction();
+    }
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 4);
+    TEST_CHECK(canIfFrames[3][0] == ((CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_WT));
+    TEST_CHECK(Det_ReportRuntimeError_fake.call_count == 1);
+    TEST_CHECK(Det_ReportRuntimeError_fake.arg3_val == CANTP_E_RX_COM);
+    // PduR never accepted the reception, so it is not indicated either
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 0);
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_FREE);
+
+    // TEST 3 - FF longer than the frames of the NSdu, the buffers following ffBuf stay untouched
+    uint8 fdFf[CAN_FD_MAX_LEN] = {CANTP_N_PCI_TYPE_FF << 4, 100};
+    memset(&fdFf[2], 0xA5, CAN_FD_MAX_LEN - 2);
+    PduInfoType fdPdu = {.SduDataPtr = fdFf, .MetaDataPtr = NULL, .SduLength = CAN_FD_MAX_LEN};
+    // The FF would be kept by the next free connection
+    const CanTp_RxConnection *freeConn = &CanTp_State.rxConnections[CanTp_State.rxActive[CanTp_State.rxActiveCount]];
+    uint8 guard[CAN_FD_MAX_LEN - CAN_2_0_MAX_LEN];
+    memcpy(guard, &freeConn->ffBuf[CAN_2_0_MAX_LEN], ARR_SIZE(guard));
+    uint32 started = PduR_CanTpStartOfReception_fake.call_count;
+    CanTp_RxIndication(101, &fdPdu);
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.call_count == started);
+    TEST_CHECK(memcmp(guard, &freeConn->ffBuf[CAN_2_0_MAX_LEN], ARR_SIZE(guard)) == 0);
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_FREE);
+
+    // TEST 4 - FF too short for its N_PCI, without padding
+    config.channels[0].rxNSdu[0].paddingActivation = CANTP_OFF;
+    CanTp_Init(&config);
+    pdu.SduLength = 1;
+    CanTp_RxIndication(101, &pdu);
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.call_count == started);
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_FREE);
+
+    // TEST 5 - PduR can't take the message, the sender is told with FC.OVFLW
+    PduR_CanTpStartOfReception_fake.custom_fake = NULL;
+    PduR_CanTpStartOfReception_fake.return_val = BUFREQ_OVFL;
+    pdu.SduLength = 8;
+    uint32 sent = CanIf_Transmit_fake.call_count;
+    CanTp_RxIndication(101, &pdu);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == sent + 1);
+    TEST_CHECK(canIfFrames[sent][0] == ((CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_OVF));
+    TEST_CHECK(canIfFrames[sent][1] == 0);
+    CanTp_MainFunction();
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 0);
+
+    // TEST 6 - CanIf refuses the FC, a reception PduR accepted is indicated as failed
+    PduR_CanTpStartOfReception_fake.custom_fake = PduR_CanTpStartOfReception_MOCK;
+    CanIf_Transmit_fake.custom_fake = NULL;
+    CanIf_Transmit_fake.return_val = E_NOT_OK;
+    CanTp_RxIndication(101, &pdu);
+    CanTp_MainFunction();
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 1);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.arg1_val == E_NOT_OK);
+    CanTp_MainFunction();
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_FREE);
+
+    // TEST 7 - FC.WAIT refused while PduR is busy, the reception was never accepted
+    PduR_CanTpStartOfReception_fake.custom_fake = PduR_CanTpStartOfReception_BUSY_MOCK;
+    rxStartBusyCount = 10;
+    CanTp_RxIndication(101, &pdu);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 1);
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_FREE);
+}
+
+void TestOf_CanTp_AddressDemux(void){
+    static const CanTp_NPduType sharedNPdu = {.id = 300};
+    static const CanTp_NTaType rxTa[3] = {{0x10}, {0x11}, {0x12}};
+    static const CanTp_NSaType ecuSa = {0xF1};
+    static const CanTp_NTaType txTa = {0x55};
+    static const CanTp_NSaType txSa = {0x66};
+    uint8 data[20] = {0};
+    PduInfoType txPdu = {.SduDataPtr = data, .MetaDataPtr = NULL, .SduLength = 3};
+    uint8 frame[8] = {0x11, (CANTP_N_PCI_TYPE_SF << 4) | 3, 'a', 'b', 'c'};
+    PduInfoType pdu = {.SduDataPtr = frame, .MetaDataPtr = NULL, .SduLength = 5};
+
+    PduR_CanTpStartOfReception_fake.custom_fake = PduR_CanTpStartOfReception_MOCK;
+    PduR_CanTpCopyRxData_fake.custom_fake = PduR_CanTpCopyRxData_MOCK;
+    PduR_CanTpCopyTxData_fake.custom_fake = PduR_CanTpCopyTxData_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_CONFIRM_MOCK;
+    for (uint32 nsduItr = 0; nsduItr < 3; nsduItr++){
+        config.channels[0].rxNSdu[nsduItr].addressingFormat = CANTP_EXTENDED;
+        config.channels[0].rxNSdu[nsduItr].paddingActivation = CANTP_OFF;
+        config.channels[0].rxNSdu[nsduItr].rxNPdu = &sharedNPdu;
+        config.channels[0].rxNSdu[nsduItr].pNTa = &rxTa[nsduItr];
+        config.channels[0].rxNSdu[nsduItr].pNSa = &ecuSa;
+    }
+    config.channels[1].txNSdu[0].addressingFormat = CANTP_EXTENDED;
+    config.channels[1].txNSdu[0].paddingActivation = CANTP_OFF;
+    config.channels[1].txNSdu[0].pNTa = &txTa;
+    config.channels[1].txNSdu[0].pNSa = &txSa;
+    CanTp_Init(&config);
+
+    // TEST 1 - NSdus sharing an N-PDU are told apart by N_TA
+    CanTp_RxIndication(300, &pdu);
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.call_count == 1);
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.arg0_val == 102);
+    TEST_CHECK(testBuffer[0] == 'a' && testBuffer[2] == 'c');
+
+    frame[0] = 0x13;
+    CanTp_RxIndication(300, &pdu);
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.call_count == 1);
+
+    // TEST 2 - FC of a reception is sent with N_SA
+    uint8 ff[8] = {0x12, CANTP_N_PCI_TYPE_FF << 4, 20, 1, 2, 3, 4, 5};
+    pdu.SduDataPtr = ff;
+    pdu.SduLength = 8;
+    CanTp_RxIndication(300, &pdu);
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.arg0_val == 103);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 1);
+    TEST_CHECK(canIfFrames[0][0] == 0xF1);
+    TEST_CHECK(canIfFrames[0][1] == ((CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_CTS));
+
+    // TEST 3 - N_TA is put in front of sent frames
+    txDataLeft = 3;
+    CanTp_Transmit(206, &txPdu);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 2);
+    TEST_CHECK(canIfFrames[1][0] == 0x55);
+    TEST_CHECK(canIfFrames[1][1] == ((CANTP_N_PCI_TYPE_SF << 4) | 3));
+
+    // TEST 4 - only an FC from N_SA continues the transmission
+    uint8 fc[4] = {0x77, CANTP_N_PCI_TYPE_FC << 4, 0, 0};
+    PduInfoType fcPdu = {.SduDataPtr = fc, .MetaDataPtr = NULL, .SduLength = 4};
+    txDataLeft = 20;
+    txPdu.SduLength = 20;
+    CanTp_Transmit(206, &txPdu);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(canIfFrames[2][0] == 0x55);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_FC);
+    CanTp_RxIndication(206, &fcPdu);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_FC);
+    fc[0] = 0x66;
+    CanTp_RxIndication(206, &fcPdu);
+    TEST_CHECK(txStateOf(206) != CANTP_TX_STATE_WAIT_FC);
+
+    // TEST 5 - frames ending with the address byte are dropped, no byte past them is read
+    uint8 shortCf[1] = {0x12};
+    PduInfoType shortPdu = {.SduDataPtr = shortCf, .MetaDataPtr = NULL, .SduLength = ARR_SIZE(shortCf)};
+    uint32 copied = PduR_CanTpCopyRxData_fake.call_count;
+    CanTp_RxIndication(300, &shortPdu);
+    TEST_CHECK(PduR_CanTpCopyRxData_fake.call_count == copied);
+    TEST_CHECK(rxStateOf(103) == CANTP_RX_STATE_WAIT_CF);
+
+    // TEST 6 - the shared N-PDU id is the id of another NSdu, the configuration is rejected
+    config.channels[1].rxNSdu[0].id = 300;
+    CanTp_Init(&config);
+    TEST_CHECK(!CANTP_IS_ON());
+    TEST_CHECK(Det_ReportRuntimeError_fake.arg3_val == CANTP_E_INIT_FAILED);
+    uint32 started = PduR_CanTpStartOfReception_fake.call_count;
+    frame[0] = 0x13;
+    pdu.SduDataPtr = frame;
+    pdu.SduLength = 5;
+    CanTp_RxIndication(300, &pdu);
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.call_count == started);
+}
+
+void TestOf_CanTp_FixedAddressing(void){
+    static const CanTp_NTaType ecuTa = {0x20};
+    static const CanTp_NTaType txTa = {0x33};
+    static const CanTp_NSaType txSa = {0x20};
+    uint8 meta[4];
+    uint8 ff[8] = {CANTP_N_PCI_TYPE_FF << 4, 20, 1, 2, 3, 4, 5, 6};
+    uint8 cf[8] = {(CANTP_N_PCI_TYPE_CF << 4) | 1, 7, 8, 9, 10, 11, 12, 13};
+    PduInfoType pdu = {.SduDataPtr = ff, .MetaDataPtr = meta, .SduLength = 8};
+    uint8 data[20] = {0};
+    PduInfoType txPdu = {.SduDataPtr = data, .MetaDataPtr = NULL, .SduLength = 3};
+    CanTp_PoolStatsType rxStats;
+    CanTp_PoolStatsType txStats;
+
+    PduR_CanTpStartOfReception_fake.custom_fake = PduR_CanTpStartOfReception_MOCK;
+    PduR_CanTpCopyRxData_fake.custom_fake = PduR_CanTpCopyRxData_MOCK;
+    PduR_CanTpCopyTxData_fake.custom_fake = PduR_CanTpCopyTxData_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_CONFIRM_MOCK;
+    config.channels[0].rxNSdu[0].addressingFormat = CANTP_NORMALFIXED;
+    config.channels[0].rxNSdu[0].pNTa = &ecuTa;
+    config.channels[1].txNSdu[0].addressingFormat = CANTP_NORMALFIXED;
+    config.channels[1].txNSdu[0].pNTa = &txTa;
+    config.channels[1].txNSdu[0].pNSa = &txSa;
+    CanTp_Init(&config);
+
+    // TEST 1 - each tester N_SA gets its own reception of the NSdu
+    CanTp_CanIdToMetaData(0x18DA20F1U, meta);
+    CanTp_RxIndication(101, &pdu);
+    CanTp_CanIdToMetaData(0x18DA20F2U, meta);
+    CanTp_RxIndication(101, &pdu);
+    CanTp_GetPoolStats(&rxStats, &txStats);
+    TEST_CHECK(rxStats.inUse == 2);
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.call_count == 2);
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.arg1_val->MetaDataPtr[0] == 0xF2);
+
+    // Frames to another N_TA are not for this ECU
+    CanTp_CanIdToMetaData(0x18DA21F3U, meta);
+    CanTp_RxIndication(101, &pdu);
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.call_count == 2);
+
+    // TEST 2 - FC are sent back to each tester
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 2);
+    TEST_CHECK((canIfCanId[0] == 0x18DAF120U && canIfCanId[1] == 0x18DAF220U) ||
+               (canIfCanId[0] == 0x18DAF220U && canIfCanId[1] == 0x18DAF120U));
+
+    // TEST 3 - CF reaches the reception of its tester only
+    pdu.SduDataPtr = cf;
+    CanTp_CanIdToMetaData(0x18DA20F2U, meta);
+    CanTp_RxIndication(101, &pdu);
+    TEST_CHECK(PduR_CanTpCopyRxData_fake.call_count == 3);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 0);
+    cf[0] = (CANTP_N_PCI_TYPE_CF << 4) | 2;
+    CanTp_RxIndication(101, &pdu);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 1);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.arg1_val == E_OK);
+    CanTp_MainFunction();
+    CanTp_GetPoolStats(&rxStats, &txStats);
+    TEST_CHECK(rxStats.inUse == 1);
+
+    // TEST 4 - sent CAN ID is built from the configured addresses or taken from the meta data
+    txDataLeft = 3;
+    CanTp_Transmit(206, &txPdu);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 3);
+    TEST_CHECK(canIfCanId[2] == 0x18DA3320U);
+
+    CanTp_CanIdToMetaData(0x18DA4420U, meta);
+    txPdu.MetaDataPtr = meta;
+    txPdu.SduLength = 20;
+    txDataLeft = 20;
+    CanTp_Transmit(206, &txPdu);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(canIfCanId[3] == 0x18DA4420U);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_FC);
+
+    // TEST 5 - only the FC of the addressed receiver continues the transmission
+    uint8 fc[8] = {CANTP_N_PCI_TYPE_FC << 4, 0, 0};
+    PduInfoType fcPdu = {.SduDataPtr = fc, .MetaDataPtr = meta, .SduLength = 8};
+    CanTp_CanIdToMetaData(0x18DA2033U, meta);
+    CanTp_RxIndication(206, &fcPdu);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_FC);
+    CanTp_CanIdToMetaData(0x18DA2044U, meta);
+    CanTp_RxIndication(206, &fcPdu);
+    TEST_CHECK(txStateOf(206) != CANTP_TX_STATE_WAIT_FC);
+
+    // TEST 6 - the tester bound first finishes, the NSdu still refers to the one receiving
+    CanTp_Init(&config);
+    pdu.SduDataPtr = ff;
+    CanTp_CanIdToMetaData(0x18DA20F1U, meta);
+    CanTp_RxIndication(101, &pdu);
+    CanTp_CanIdToMetaData(0x18DA20F2U, meta);
+    CanTp_RxIndication(101, &pdu);
+    CanTp_MainFunction();
+    pdu.SduDataPtr = cf;
+    CanTp_CanIdToMetaData(0x18DA20F1U, meta);
+    cf[0] = (CANTP_N_PCI_TYPE_CF << 4) | 1;
+    CanTp_RxIndication(101, &pdu);
+    cf[0] = (CANTP_N_PCI_TYPE_CF << 4) | 2;
+    CanTp_RxIndication(101, &pdu);
+    CanTp_MainFunction();
+    CanTp_GetPoolStats(&rxStats, &txStats);
+    TEST_CHECK(rxStats.inUse == 1);
+    TEST_CHECK(getRxConnection(101) != NULL);
+    TEST_CHECK(rxStateOf(101) == CANTP_RX_STATE_WAIT_CF);
+    TEST_CHECK(CanTp_ChangeParameter(101, TP_STMIN, 1) == E_NOT_OK);
+    TEST_CHECK(CanTp_CancelReceive(101) == E_OK);
+}
+
+void TestOf_CanTp_Padding(void){
+    uint8 data[20] = {0};
+    PduInfoType pduInfo = {.SduDataPtr = data, .MetaDataPtr = NULL, .SduLength = 3};
+
+    PduR_CanTpCopyTxData_fake.custom_fake = PduR_CanTpCopyTxData_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_CONFIRM_MOCK;
+    config.channels[1].txNSdu[0].paddingActivation = CANTP_OFF;
+    config.channels[1].txNSdu[1].paddingActivation = CANTP_OFF;
+    config.channels[1].txNSdu[1].maxFrameLen = CAN_FD_MAX_LEN;
+    config.channels[1].txNSdu[2].maxFrameLen = CAN_FD_MAX_LEN;
+    CanTp_Init(&config);
+
+    // TEST 1 - without padding classic frames are sent as they are
+    txDataLeft = 3;
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(canIfFrameLen[0] == 4);
+
+    // TEST 2 - CAN FD frames are filled up to the next DLC only, padding on or off
+    txDataLeft = 10;
+    pduInfo.SduLength = 10;
+    CanTp_Transmit(207, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(canIfFrameLen[1] == 12);
+
+    txDataLeft = 11;
+    pduInfo.SduLength = 11;
+    CanTp_Transmit(207, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(canIfFrameLen[2] == 16);
+    TEST_CHECK(canIfFrames[2][13] == CONFIG_CANTP_PADDING_BYTE && canIfFrames[2][15] == CONFIG_CANTP_PADDING_BYTE);
+
+    // TEST 3 - short CAN FD frames with padding are filled up to 8 bytes
+    txDataLeft = 3;
+    pduInfo.SduLength = 3;
+    CanTp_Transmit(208, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(canIfFrameLen[3] == CAN_2_0_MAX_LEN);
+    TEST_CHECK(canIfFrames[3][4] == CONFIG_CANTP_PADDING_BYTE);
+
+    // TEST 4 - a frame length between two DLCs is cut to the lower one
+    TEST_CHECK(CanTp_FrameLen(30) == 24);
+    TEST_CHECK(CanTp_FrameLen(CAN_FD_MAX_LEN) == CAN_FD_MAX_LEN);
+}
+
+void TestOf_CanTp_TxRetry(void){
+    uint8 data[20] = {0};
+    PduInfoType pduInfo = {.SduDataPtr = data, .MetaDataPtr = NULL, .SduLength = ARR_SIZE(data)};
+    uint8 fcPayload[3] = {CANTP_N_PCI_TYPE_FC << 4, 0, 0};
+    PduInfoType fc = {.SduDataPtr = fcPayload, .MetaDataPtr = NULL, .SduLength = 3};
+
+    PduR_CanTpCopyTxData_fake.custom_fake = PduR_CanTpCopyTxData_RETRY_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_MOCK;
+    CanTp_Init(&config);
+
+    // TEST 1 - a lost FF is sent again with the payload PduR is asked to copy once more
+    txDataLeft = ARR_SIZE(data);
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(txRetryHistory[0].TpDataStateType == TP_CONFPENDING);
+    CanTp_TxConfirmation(206, E_NOT_OK);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FF_SEND_REQ);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(PduR_CanTpCopyTxData_fake.call_count == 2);
+    TEST_CHECK(txRetryHistory[1].TpDataStateType == TP_DATARETRY && txRetryHistory[1].TxTpDataCnt == 6);
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 2);
+    TEST_CHECK(memcmp(canIfFrames[0], canIfFrames[1], CAN_2_0_MAX_LEN) == 0);
+    CanTp_TxConfirmation(206, E_OK);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_FC);
+
+    // TEST 2 - FC.CTS releases the data the receiver already has
+    CanTp_RxIndication(206, &fc);
+    CanTp_MainFunction();
+    TEST_CHECK(txRetryHistory[2].TpDataStateType == TP_DATA_CONF);
+    TEST_CHECK(canIfFrames[2][0] == ((CANTP_N_PCI_TYPE_CF << 4) | 1));
+
+    // TEST 3 - a lost CF keeps its sequence number, the next one continues after it
+    CanTp_TxConfirmation(206, E_NOT_OK);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_CF_SEND_REQ);
+    CanTp_MainFunction();
+    TEST_CHECK(txRetryHistory[3].TpDataStateType == TP_DATARETRY && txRetryHistory[3].TxTpDataCnt == 7);
+    TEST_CHECK(canIfFrames[3][0] == ((CANTP_N_PCI_TYPE_CF << 4) | 1));
+    CanTp_TxConfirmation(206, E_OK);
+    CanTp_MainFunction();
+    TEST_CHECK(txRetryHistory[4].TpDataStateType == TP_CONFPENDING);
+    TEST_CHECK(canIfFrames[4][0] == ((CANTP_N_PCI_TYPE_CF << 4) | 2));
+    CanTp_TxConfirmation(206, E_OK);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.arg1_val == E_OK);
+
+    // TEST 4 - the transfer is aborted once CONFIG_CANTP_TX_RETRY_MAX retransmissions were lost
+    pduInfo.SduLength = 3;
+    txDataLeft = 3;
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    for (uint8 retryItr = 0; retryItr < CONFIG_CANTP_TX_RETRY_MAX; retryItr++){
+        CanTp_TxConfirmation(206, E_NOT_OK);
+        TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_SF_SEND_REQ);
+        CanTp_MainFunction();
+        CanTp_MainFunction();
+    }
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 6 + CONFIG_CANTP_TX_RETRY_MAX);
+    CanTp_TxConfirmation(206, E_NOT_OK);
+    CanTp_MainFunction();
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.arg1_val == E_NOT_OK);
+}
+
+void TestOf_CanTp_Streaming(void){
+    uint8 data[5000] = {0};
+    PduInfoType pduInfo = {.SduDataPtr = data, .MetaDataPtr = NULL, .SduLength = ARR_SIZE(data)};
+    uint8 fcPayload[3] = {CANTP_N_PCI_TYPE_FC << 4, 0, 0};
+    PduInfoType fc = {.SduDataPtr = fcPayload, .MetaDataPtr = NULL, .SduLength = 3};
+    uint8 ff[8] = {CANTP_N_PCI_TYPE_FF << 4, 0, 0, 0, 0x13, 0x88, 0, 1};
+    uint8 cf[8] = {0};
+    PduInfoType pdu = {.SduDataPtr = ff, .MetaDataPtr = NULL, .SduLength = 8};
+    uint32 frameCount = 0;
+
+    PduR_CanTpCopyTxData_fake.custom_fake = PduR_CanTpCopyTxData_STREAM_MOCK;
+    PduR_CanTpStartOfReception_fake.custom_fake = PduR_CanTpStartOfReception_BUFFER_MOCK;
+    PduR_CanTpCopyRxData_fake.custom_fake = PduR_CanTpCopyRxData_STREAM_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_CONFIRM_MOCK;
+    config.channels[1].txNSdu[0].txStagingSize = 64;
+    config.channels[0].rxNSdu[0].adaptiveBs = TRUE;
+    CanTp_Init(&config);
+
+    // TEST 1 - 5000 bytes are sent with the 32 bit FF_DL while PduR holds only two CFs ahead
+    txDataLeft = ARR_SIZE(data);
+    txStreamWindow = 14;
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(canIfFrames[0][0] == (CANTP_N_PCI_TYPE_FF << 4) && canIfFrames[0][1] == 0);
+    TEST_CHECK(canIfFrames[0][4] == 0x13 && canIfFrames[0][5] == 0x88);
+    CanTp_RxIndication(206, &fc);
+    for (uint32 mfItr = 0; (mfItr < 2000) && (txStateOf(206) != CANTP_TX_STATE_FREE); mfItr++){
+        CanTp_MainFunction();
+    }
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.arg1_val == E_OK);
+    TEST_CHECK(txDataLeft == 0);
+    // FF with 2 bytes of payload and 714 CFs
+    TEST_CHECK(CanIf_Transmit_fake.call_count == 1 + 714);
+
+    // TEST 2 - 5000 bytes are received through a 64 byte buffer, each block is sized to it
+    RESET_FAKE(CanIf_Transmit);
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_MOCK;
+    rxBufferLeft = 64;
+    rxStreamedBytes = 0;
+    CanTp_RxIndication(101, &pdu);
+    pdu.SduDataPtr = cf;
+    for (uint32 cfItr = 1; cfItr <= 714; cfItr++){
+        if (rxStateOf(101) != CANTP_RX_STATE_WAIT_CF){
+            CanTp_MainFunction();
+            frameCount++;
+        }
+        cf[0] = (uint8)((CANTP_N_PCI_TYPE_CF << 4) | (cfItr & 0x0F));
+        CanTp_RxIndication(101, &pdu);
+    }
+    TEST_CHECK(rxStreamedBytes == ARR_SIZE(data));
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 1 && PduR_CanTpRxIndication_fake.arg1_val == E_OK);
+    // 64 / 7 = 9 CFs per block
+    TEST_CHECK(canIfFrames[0][1] == 9);
+    TEST_CHECK(frameCount == (714 + 8) / 9);
+    TEST_CHECK(CanIf_Transmit_fake.call_count == frameCount);
+
+    // TEST 3 - an escaped FF_DL which would fit into 12 bits is invalid
+    ff[4] = 0x0F;
+    ff[5] = 0xFF;
+    uint8 pciSize;
+    TEST_CHECK(CanTp_DecodeFrameDL(CANTP_N_PCI_TYPE_FF, ff, ARR_SIZE(ff), 0, &pciSize) == 0);
+}
+
+void TestOf_CanTp_RxWindow(void){
+    uint8 ff[8] = {CANTP_N_PCI_TYPE_FF << 4, 200, 0, 1, 2, 3, 4, 5};
+    uint8 cf[8] = {0};
+    PduInfoType pdu = {.SduDataPtr = ff, .MetaDataPtr = NULL, .SduLength = 8};
+    const PduLengthType windows[] = {21, 35, 7, 70};
+    uint32 cfItr = 0;
+
+    PduR_CanTpStartOfReception_fake.custom_fake = PduR_CanTpStartOfReception_BUFFER_MOCK;
+    PduR_CanTpCopyRxData_fake.custom_fake = PduR_CanTpCopyRxData_STREAM_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_MOCK;
+    config.channels[0].rxNSdu[0].adaptiveBs = TRUE;
+    config.channels[0].rxNSdu[0].rxReassemblySize = 14;
+    CanTp_Init(&config);
+
+    // TEST 1 - every block is sized to the buffer PduR reported when the previous one was copied
+    rxBufferLeft = windows[0];
+    rxStreamedBytes = 0;
+    CanTp_RxIndication(101, &pdu);
+    pdu.SduDataPtr = cf;
+    for (uint32 blockItr = 0; blockItr < ARR_SIZE(windows); blockItr++){
+        CanTp_MainFunction();
+        TEST_CHECK(canIfFrames[blockItr][1] == windows[blockItr] / 7);
+        rxBufferLeft = (blockItr + 1 < ARR_SIZE(windows)) ? windows[blockItr + 1] : 0;
+        for (uint32 itr = 0; itr < windows[blockItr] / 7; itr++){
+            cfItr++;
+            cf[0] = (uint8)((CANTP_N_PCI_TYPE_CF << 4) | (cfItr & 0x0F));
+            CanTp_RxIndication(101, &pdu);
+        }
+    }
+    // The reassembly window is handed over when full and at the end of each block
+    TEST_CHECK(rxStreamedBytes == 6 + 133);
+    TEST_CHECK(PduR_CanTpCopyRxData_fake.call_count == 1 + 2 + 3 + 1 + 5);
+
+    // TEST 2 - the 61 bytes left fit into the last window, BS = 0 finishes the message
+    rxBufferLeft = 100;
+    CanTp_MainFunction();
+    TEST_CHECK(canIfFrames[4][1] == 0);
+    for (uint32 itr = 0; itr < 9; itr++){
+        cfItr++;
+        cf[0] = (uint8)((CANTP_N_PCI_TYPE_CF << 4) | (cfItr & 0x0F));
+        CanTp_RxIndication(101, &pdu);
+    }
+    TEST_CHECK(rxStreamedBytes == 200);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.arg1_val == E_OK);
+}
+
+void TestOf_CanTp_ChannelMode(void){
+    uint8 data[20] = {0};
+    PduInfoType pduInfo = {.SduDataPtr = data, .MetaDataPtr = NULL, .SduLength = ARR_SIZE(data)};
+    uint8 ff[8] = {CANTP_N_PCI_TYPE_FF << 4, 20, 0, 1, 2, 3, 4, 5};
+    uint8 cf[8] = {(CANTP_N_PCI_TYPE_CF << 4) | 1, 6, 7, 8, 9, 10, 11, 12};
+    uint8 fc[8] = {CANTP_N_PCI_TYPE_FC << 4, 0, 0};
+    PduInfoType ffPdu = {.SduDataPtr = ff, .MetaDataPtr = NULL, .SduLength = 8};
+    PduInfoType cfPdu = {.SduDataPtr = cf, .MetaDataPtr = NULL, .SduLength = 8};
+    PduInfoType fcPdu = {.SduDataPtr = fc, .MetaDataPtr = NULL, .SduLength = 8};
+
+    PduR_CanTpStartOfReception_fake.custom_fake = PduR_CanTpStartOfReception_MOCK;
+    PduR_CanTpCopyRxData_fake.custom_fake = PduR_CanTpCopyRxData_MOCK;
+    PduR_CanTpCopyTxData_fake.custom_fake = PduR_CanTpCopyTxData_MOCK;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_CONFIRM_MOCK;
+    // Request and response share the N-PDU
+    config.channels[1].rxNSdu[0].id = 206;
+    CanTp_Init(&config);
+
+    // TEST 1 - full duplex: a reception and a transmission overlap, the FC is routed to the transmission
+    CanTp_RxIndication(206, &ffPdu);
+    CanTp_MainFunction();
+    TEST_CHECK(rxStateOf(206) == CANTP_RX_STATE_WAIT_CF);
+    txDataLeft = ARR_SIZE(data);
+    TEST_CHECK(CanTp_Transmit(206, &pduInfo) == E_OK);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_FC);
+    CanTp_RxIndication(206, &fcPdu);
+    TEST_CHECK(txStateOf(206) != CANTP_TX_STATE_WAIT_FC);
+    TEST_CHECK(rxStateOf(206) == CANTP_RX_STATE_WAIT_CF);
+    CanTp_RxIndication(206, &cfPdu);
+    cf[0] = (CANTP_N_PCI_TYPE_CF << 4) | 2;
+    CanTp_RxIndication(206, &cfPdu);
+    TEST_CHECK(PduR_CanTpRxIndication_fake.call_count == 1 && PduR_CanTpRxIndication_fake.arg1_val == E_OK);
+    for (int i = 0; i < 4; i++){
+        CanTp_MainFunction();
+    }
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.call_count == 1 && PduR_CanTpTxConfirmation_fake.arg1_val == E_OK);
+
+    // TEST 2 - half duplex: no transmission while receiving and no reception while transmitting
+    config.channels[1].channelMode = CANTP_MODE_HALF_DUPLEX;
+    CanTp_Init(&config);
+    CanTp_RxIndication(206, &ffPdu);
+    TEST_CHECK(CanTp_Transmit(206, &pduInfo) == E_NOT_OK);
+    cf[0] = (CANTP_N_PCI_TYPE_CF << 4) | 1;
+    CanTp_MainFunction();
+    CanTp_RxIndication(206, &cfPdu);
+    cf[0] = (CANTP_N_PCI_TYPE_CF << 4) | 2;
+    CanTp_RxIndication(206, &cfPdu);
+    CanTp_MainFunction();
+    TEST_CHECK(rxStateOf(206) == CANTP_RX_STATE_FREE);
+
+    TEST_CHECK(CanTp_Transmit(206, &pduInfo) == E_OK);
+    CanTp_RxIndication(206, &ffPdu);
+    TEST_CHECK(rxStateOf(206) == CANTP_RX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpStartOfReception_fake.call_count == 2);
+
+    // TEST 3 - CF and FC in flight on the shared N-PDU, the confirmations follow the order of the frames
+    config.channels[1].channelMode = CANTP_MODE_FULL_DUPLEX;
+    config.channels[1].rxNSdu[0].nar = 5;
+    CanIf_Transmit_fake.custom_fake = CanIf_Transmit_MOCK;
+    CanTp_Init(&config);
+    txDataLeft = ARR_SIZE(data);
+    CanTp_Transmit(206, &pduInfo);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    CanTp_TxConfirmation(206, E_OK);
+    CanTp_RxIndication(206, &fcPdu);
+    CanTp_MainFunction();
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_WAIT_CANIF_CONFIRM);
+    CanTp_RxIndication(206, &ffPdu);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.arg0_val == 206);
+    TEST_CHECK(canIfFrames[CanIf_Transmit_fake.call_count - 1][0] == ((CANTP_N_PCI_TYPE_FC << 4) | CANTP_FS_TYPE_CTS));
+
+    CanTp_TxConfirmation(206, E_OK);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_CF_SEND_REQ);
+    TEST_CHECK(getRxConnection(206)->fcPending);
+    CanTp_TxConfirmation(206, E_OK);
+    TEST_CHECK(!getRxConnection(206)->fcPending);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_CF_SEND_REQ);
+
+    CanTp_MainFunction();
+    CanTp_TxConfirmation(206, E_OK);
+    TEST_CHECK(txStateOf(206) == CANTP_TX_STATE_FREE);
+    TEST_CHECK(PduR_CanTpTxConfirmation_fake.arg1_val == E_OK);
+    TEST_CHECK(rxStateOf(206) == CANTP_RX_STATE_WAIT_CF);
+
+    // TEST 4 - FC sent and confirmed with the confirmation PduId of its N-PDU
+    static const CanTp_FcNPduType fcNPdu = {.nPduConfirmationPduId = 250, .ref = 250};
+    config.channels[1].rxNSdu[0].txFcNPdu = &fcNPdu;
+    CanTp_Init(&config);
+    CanTp_RxIndication(206, &ffPdu);
+    CanTp_MainFunction();
+    TEST_CHECK(CanIf_Transmit_fake.arg0_val == 250);
+    TEST_CHECK(getRxConnection(206)->fcPending);
+    CanTp_TxConfirmation(206, E_OK);
+    TEST_CHECK(getRxConnection(206)->fcPending);
+    TEST_CHECK(CanTp_State.rxFcPendingCount == 1);
+    CanTp_TxConfirmation(250, E_OK);
+    TEST_CHECK(!getRxConnection(206)->fcPending);
+    TEST_CHECK(CanTp_State.rxFcPendingCount == 0);
+
+    // TEST 5 - a reception freed with its FC unconfirmed is no longer counted
+    CanTp_RxIndication(206, &ffPdu);
+    CanTp_MainFunction();
+    TEST_CHECK(CanTp_State.rxFcPendingCount == 1);
+    TEST_CHECK(CanTp_CancelReceive(206) == E_OK);
+    CanTp_MainFunction();
+    CanTp_MainFunction();
+    TEST_CHECK(rxStateOf(206) == CANTP_RX_STATE_FREE);
+    TEST_CHECK(CanTp_State.rxFcPendingCount == 0);
+}
+
+void TestOf_CanTp_Footprint(void){
+    // TEST 1 - NSdu slots hold the configuration, the BS/STmin overlay and the bound connection, no buffers
+    TEST_CHECK(sizeof(CanTp_RxNSduSlot) <= (2U * sizeof(void *)) + 8U);
+    TEST_CHECK(sizeof(CanTp_TxNSduSlot) <= (2U * sizeof(void *)) + 8U);
+
+    // TEST 2 - the pool holds a frame per tx connection and an FC per rx connection, whatever the NSdu count
+    CanTp_Init(&config);
+    TEST_CHECK(CANTP_IS_ON());
+    TEST_CHECK((uint32)(CanTp_State.rxConnections[CANTP_RX_CONNECTIONS_COUNT - 1].fcBuf.data + CAN_2_0_MAX_LEN - CanTp_State.frameBufferPool) ==
+               (CANTP_TX_CONNECTIONS_COUNT + CANTP_RX_CONNECTIONS_COUNT) * CAN_2_0_MAX_LEN);
+
+    // TEST 3 - staging buffers the pool can not hold are left out, the connections send without them
+    config.channels[1].txNSdu[0].txStagingSize = CONFIG_CANTP_FRAME_BUFFER_POOL_SIZE;
+    CanTp_Init(&config);
+    TEST_CHECK(CANTP_IS_ON());
+    TEST_CHECK(Det_ReportRuntimeError_fake.arg3_val == CANTP_E_INIT_FAILED);
+    TEST_CHECK(CanTp_State.txConnections[0].staging.data == NULL);
+}
+
 TEST_LIST = {
     {"Test_Of_CanTp_Init",Test_Of_CanTp_Init},    // Format to {"nazwa testu", nazwa_funkcji}
     {"Test_Of_CanTp_Shutdown", Test_Of_CanTp_Shutdown},
@@ -332,5 +1998,30 @@ TEST_LIST = {
     {"TestOf_CanTp_CancelTransmit", TestOf_CanTp_CancelTransmit},
     {"TestOf_CanTp_CancelReceive", TestOf_CanTp_CancelReceive},
     {"TestOf_CanTp_RxIndication", TestOf_CanTp_RxIndication},
+    {"TestOf_CanTp_PduIndex", TestOf_CanTp_PduIndex},
+    {"TestOf_CanTp_ActiveConnections", TestOf_CanTp_ActiveConnections},
+    {"TestOf_CanTp_Timeouts", TestOf_CanTp_Timeouts},
+    {"TestOf_CanTp_ImmediateDispatch", TestOf_CanTp_ImmediateDispatch},
+    {"TestOf_CanTp_CfBurst", TestOf_CanTp_CfBurst},
+    {"TestOf_CanTp_Framing", TestOf_CanTp_Framing},
+    {"TestOf_CanTp_FrameLength", TestOf_CanTp_FrameLength},
+    {"TestOf_CanTp_ZeroCopy", TestOf_CanTp_ZeroCopy},
+    {"TestOf_CanTp_TxStaging", TestOf_CanTp_TxStaging},
+    {"TestOf_CanTp_RxReassembly", TestOf_CanTp_RxReassembly},
+    {"TestOf_CanTp_TxConfirmation", TestOf_CanTp_TxConfirmation},
+    {"TestOf_CanTp_ConnectionPool", TestOf_CanTp_ConnectionPool},
+    {"TestOf_CanTp_Config", TestOf_CanTp_Config},
+    {"TestOf_CanTp_FrameLayout", TestOf_CanTp_FrameLayout},
+    {"TestOf_CanTp_FlowControl", TestOf_CanTp_FlowControl},
+    {"TestOf_CanTp_AdaptiveBlockSize", TestOf_CanTp_AdaptiveBlockSize},
+    {"TestOf_CanTp_FlowControlWait", TestOf_CanTp_FlowControlWait},
+    {"TestOf_CanTp_AddressDemux", TestOf_CanTp_AddressDemux},
+    {"TestOf_CanTp_FixedAddressing", TestOf_CanTp_FixedAddressing},
+    {"TestOf_CanTp_Padding", TestOf_CanTp_Padding},
+    {"TestOf_CanTp_TxRetry", TestOf_CanTp_TxRetry},
+    {"TestOf_CanTp_Streaming", TestOf_CanTp_Streaming},
+    {"TestOf_CanTp_RxWindow", TestOf_CanTp_RxWindow},
+    {"TestOf_CanTp_ChannelMode", TestOf_CanTp_ChannelMode},
+    {"TestOf_CanTp_Footprint", TestOf_CanTp_Footprint},
     {NULL, NULL}  // To musi być na końcu
 };